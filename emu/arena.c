@@ -0,0 +1,93 @@
+#include <base.h>
+#include <arena.h>
+
+#include <string.h>
+
+#include <sys/mman.h>
+
+// Allocations are aligned as `malloc()` would align them
+#define ARENA_ALIGN 16
+
+// The granularity the kernel backs transparent huge pages with
+#define ARENA_HUGEPAGE_SIZE (2u << 20)
+
+arena_t *
+arena_new (size_t size)
+{
+	arena_t * arena = calloc(1, sizeof(arena_t));
+	if (!arena) {
+		return NULL;
+	}
+
+	size = (size + ARENA_HUGEPAGE_SIZE - 1) & ~(size_t)(ARENA_HUGEPAGE_SIZE - 1);
+
+	// Over-reserve so that the arena can start on a huge page boundary,
+	// and give back the unaligned head and tail
+	size_t reserved = size + ARENA_HUGEPAGE_SIZE;
+	uint8_t * block = mmap(NULL, reserved, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (block == MAP_FAILED) {
+		free(arena);
+		return NULL;
+	}
+
+	uintptr_t aligned = ((uintptr_t)block + ARENA_HUGEPAGE_SIZE - 1) & ~(uintptr_t)(ARENA_HUGEPAGE_SIZE - 1);
+	size_t head = aligned - (uintptr_t)block;
+	if (head) {
+		munmap(block, head);
+	}
+	if (reserved - head - size) {
+		munmap((uint8_t *)aligned + size, reserved - head - size);
+	}
+
+	arena->base = (uint8_t *)aligned;
+	arena->size = size;
+
+#ifdef MADV_HUGEPAGE
+	madvise(arena->base, arena->size, MADV_HUGEPAGE);
+#endif
+
+	return arena;
+}
+
+void *
+arena_alloc (arena_t * arena, size_t size)
+{
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (UNLIKELY(size > arena->size - arena->used)) {
+		return NULL;
+	}
+
+	// Freshly-mapped (or reset) arena memory is already zeroed
+	void * ptr = arena->base + arena->used;
+	arena->used += size;
+	arena->nlive++;
+	return ptr;
+}
+
+void
+arena_release (arena_t * arena, void * ptr)
+{
+	ASSERT((uint8_t *)ptr >= arena->base && (uint8_t *)ptr < arena->base + arena->used);
+	ASSERT(arena->nlive != 0);
+
+	arena->nlive--;
+}
+
+void
+arena_reset (arena_t * arena)
+{
+	ASSERT(arena->nlive == 0);
+
+	memset(arena->base, 0x00, arena->used);
+	arena->used = 0;
+}
+
+void
+arena_free (arena_t * arena)
+{
+	ASSERT(arena->nlive == 0);
+
+	munmap(arena->base, arena->size);
+	free(arena);
+}
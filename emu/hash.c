@@ -0,0 +1,108 @@
+#include <hash.h>
+
+#include <string.h>
+
+// See [https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md] for the
+// specification this follows
+
+#define PRIME64_1 0x9E3779B185EBCA87ull
+#define PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define PRIME64_3 0x165667B19E3779F9ull
+#define PRIME64_4 0x85EBCA77C2B2AE63ull
+#define PRIME64_5 0x27D4EB2F165667C5ull
+
+static inline uint64_t
+rotl64 (uint64_t x, unsigned r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+// Input is read as little-endian words, which is how every host we build on
+// stores them
+static inline uint64_t
+read64 (const uint8_t * nonnull p)
+{
+	uint64_t val;
+	memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+static inline uint32_t
+read32 (const uint8_t * nonnull p)
+{
+	uint32_t val;
+	memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+static inline uint64_t
+round64 (uint64_t acc, uint64_t lane)
+{
+	acc += lane * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static inline uint64_t
+merge_round64 (uint64_t acc, uint64_t val)
+{
+	acc ^= round64(0, val);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t
+hash64 (const void * data, size_t nbytes, uint64_t seed)
+{
+	const uint8_t * p = data;
+	const uint8_t * end = p + nbytes;
+	uint64_t acc;
+
+	if (nbytes >= 32) {
+		// Four independent accumulators, each taking every fourth
+		// 8-byte lane of each 32-byte stripe
+		uint64_t accs[4] = {
+			seed + PRIME64_1 + PRIME64_2,
+			seed + PRIME64_2,
+			seed,
+			seed - PRIME64_1,
+		};
+		for (; p + 32 <= end; p += 32) {
+			for (size_t i = 0; i < 4; i++) {
+				accs[i] = round64(accs[i], read64(p + 8 * i));
+			}
+		}
+
+		acc = rotl64(accs[0], 1) + rotl64(accs[1], 7) + rotl64(accs[2], 12) + rotl64(accs[3], 18);
+		for (size_t i = 0; i < 4; i++) {
+			acc = merge_round64(acc, accs[i]);
+		}
+	}
+	else {
+		acc = seed + PRIME64_5;
+	}
+
+	acc += nbytes;
+
+	// Consume whatever's left of the input that didn't fill a stripe
+	for (; p + 8 <= end; p += 8) {
+		acc ^= round64(0, read64(p));
+		acc = rotl64(acc, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (p + 4 <= end) {
+		acc ^= read32(p) * PRIME64_1;
+		acc = rotl64(acc, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		acc ^= *p * PRIME64_5;
+		acc = rotl64(acc, 11) * PRIME64_1;
+	}
+
+	// Mix the bits of the final accumulator together
+	acc ^= acc >> 33;
+	acc *= PRIME64_2;
+	acc ^= acc >> 29;
+	acc *= PRIME64_3;
+	acc ^= acc >> 32;
+	return acc;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// An arena is a single contiguous block of memory that reference-counted
+// objects can be carved out of, instead of each being individually allocated
+// from the heap. Building a whole machine inside one arena keeps its devices
+// close together in memory, lets the block be backed by huge pages, and makes
+// tearing the machine down a single unmapping (or, if the arena is going to be
+// reused for another machine, a single `memset`).
+//
+// Arenas are selected per-thread with `rc_use_arena()`; see `rc.h`.
+
+#include <base.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The default amount of address space reserved for a machine's arena. Only
+// the parts of it which are actually allocated are ever touched.
+#define ARENA_DEFAULT_SIZE (16u << 20)
+
+typedef struct arena {
+	uint8_t * nonnull /*owned*/ base;
+	size_t size;
+	size_t used;
+
+	// The number of allocations that have not yet been given back with
+	// `arena_release()`
+	size_t nlive;
+} arena_t;
+
+// Reserves a new arena with room for `size` bytes of allocations. Returns NULL
+// if the address space couldn't be reserved.
+arena_t * nullable arena_new (size_t size);
+
+// Allocates `size` zeroed bytes from `arena`, or returns NULL if the arena is
+// exhausted. Allocations are never individually freed.
+void * nullable arena_alloc (arena_t * nonnull arena, size_t size);
+
+// Marks an allocation from `arena` as no longer in use. This only does
+// bookkeeping; the memory is reclaimed by `arena_reset()` or `arena_free()`.
+void arena_release (arena_t * nonnull arena, void * nonnull ptr);
+
+// Reclaims every allocation in `arena` at once, leaving it empty (and zeroed)
+// for reuse. Every allocation must already have been released.
+void arena_reset (arena_t * nonnull arena);
+
+// Destroys `arena`, returning its memory to the system. Every allocation must
+// already have been released.
+void arena_free (arena_t * nonnull arena);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <base.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Computes the 64-bit xxHash (XXH64) of the `nbytes` bytes at `data`, with
+// the given `seed`. This is the same hash as `xxhsum -H1`, so results can be
+// checked against it; it's fast enough to run over every frame the PPU draws.
+uint64_t hash64 (const void * nonnull data, size_t nbytes, uint64_t seed);
@@ -27,12 +27,14 @@ typedef struct rominfo {
 } rominfo_t;
 
 // Loads an ines-formatted ROM given a `FILE` object opened at `path`, setting
-// up both the CPU and PPU memory maps in the process. Returns a nonzero exit
-// code if an error occurs.
+// up both the CPU and PPU memory maps in the process, and storing a strong
+// reference to the PPU into `*ppu_out`. Returns a nonzero exit code if an
+// error occurs.
 int inesrom_load (FILE * nonnull f,
 		  const char * nonnull path,
 		  reset_manager_t * nonnull rm,
 		  mos6502_t * nonnull cpu,
 		  const char * nonnull palette_path,
 		  const char * nonnull cscheme_path,
-		  int scale);
+		  const video_config_t * nonnull video,
+		  ppu_t * nullable * nonnull ppu_out);
@@ -8,6 +8,28 @@
 #define MEMBUS_PAGESIZE 256
 #define MEMBUS_NPAGES 256
 
+// How a bus resolves data lanes that nothing drives during a read (i.e. reads
+// from unmapped pages, and the bits a handler reports as undriven). Only
+// handler-mapped and unmapped pages can leave lanes undriven, so reads from
+// data-mapped pages never pay for any of this, whichever model is selected.
+typedef enum membus_open_bus {
+	// Undriven lanes keep the last value driven onto them, like the
+	// capacitance of real bus lines does
+	MEMBUS_OPEN_BUS_LATCH = 0,
+	// Undriven lanes read as 1s, as if pulled up to VCC
+	MEMBUS_OPEN_BUS_PULLUP = 1,
+	// Undriven lanes read as 0s. Only correct for buses where nothing
+	// observes open-bus values, but cheapest.
+	MEMBUS_OPEN_BUS_IGNORE = 2,
+} PACKED membus_open_bus_t;
+
+// The open-bus model buses are created with
+#ifndef OPEN_BUS_TO_VCC
+#	define MEMBUS_OPEN_BUS_DEFAULT MEMBUS_OPEN_BUS_LATCH
+#else
+#	define MEMBUS_OPEN_BUS_DEFAULT MEMBUS_OPEN_BUS_PULLUP
+#endif
+
 // The mappings for 'read' and 'write' behavior are stored separately, in two
 // arrays. Each entry in an array can correspond to no mapping, a "handler
 // mapping", or a "data mapping". If the `obj` of an entry is `NULL`, then there
@@ -16,6 +38,11 @@
 // handler, and `offset_p1` is one plus the offset given when setting up the
 // handler.
 typedef struct membus {
+	// The read routine specialised for `open_bus`
+	uint8_t (* nonnull read)(struct membus * nonnull, uint16_t);
+	membus_open_bus_t open_bus;
+	uint8_t data_lanes;
+
 	struct {
 		union {
 			uint8_t (* nullable handler)(void * nonnull, uint16_t, uint8_t * nonnull);
@@ -33,23 +60,55 @@ typedef struct membus {
 		size_t offset_p1; // offset + 1
 		void * nullable /*strong*/ obj;
 	} write_mappings[MEMBUS_NPAGES];
-
-#ifndef OPEN_BUS_TO_VCC
-	uint8_t data_lanes;
-#endif
 } membus_t;
 
-// Allocates and initializes a new reference-counted memory bus. The passed
-// reset manager is used to clear latent values on the bus lanes if
-// `OPEN_BUS_TO_VCC` is not defined.
+// Allocates and initializes a new reference-counted memory bus, using
+// `MEMBUS_OPEN_BUS_DEFAULT`. The passed reset manager is used to clear latent
+// values on the bus lanes.
 membus_t * nullable membus_new (reset_manager_t * nonnull rm);
 
+// Selects how `bus` resolves undriven data lanes
+void membus_set_open_bus (membus_t * nonnull bus, membus_open_bus_t open_bus);
+
 // Reads a byte through the bus
-uint8_t membus_read (membus_t * nonnull bus, uint16_t addr);
+static inline uint8_t
+membus_read (membus_t * nonnull bus, uint16_t addr)
+{
+	return bus->read(bus, addr);
+}
+
+// Reads a little-endian 16-bit value through the bus, from `addr` and
+// `addr + 1`. When both bytes are in the same data-mapped page, this is a
+// single load.
+uint16_t membus_read16 (membus_t * nonnull bus, uint16_t addr);
+
+// Works identically to `membus_read16`, except that the high byte is read
+// from the start of the page if `addr` is the last byte of one, rather than
+// from the next page. This is how the 6502 reads zero-page pointers, pops
+// addresses off the stack, and (infamously) performs `JMP ($xxFF)`.
+uint16_t membus_read16_pagewrap (membus_t * nonnull bus, uint16_t addr);
 
 // Writes a byte through the bus
 void membus_write (membus_t * nonnull bus, uint16_t addr, uint8_t val);
 
+// Reads `len` bytes through the bus, starting at `addr` (and wrapping around
+// the top of the address space), into `dest`. The result is the same as that
+// of `len` successive `membus_read()`s, but pages with data mappings are
+// copied in bulk instead of byte-by-byte.
+void membus_copy_out (membus_t * nonnull bus,
+		      uint16_t addr,
+		      uint8_t * nonnull dest,
+		      size_t len);
+
+// Writes `len` bytes from `src` through the bus, starting at `addr` (and
+// wrapping around the top of the address space). The result is the same as
+// that of `len` successive `membus_write()`s, but pages with data mappings are
+// copied in bulk instead of byte-by-byte.
+void membus_copy_in (membus_t * nonnull bus,
+		     uint16_t addr,
+		     const uint8_t * nonnull src,
+		     size_t len);
+
 // Removes all mappings for a particular page
 void membus_clear_page (membus_t * nonnull bus, size_t pagenum);
 
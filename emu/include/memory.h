@@ -2,16 +2,19 @@
 
 #include <base.h>
 #include <membus.h>
+#include <romimage.h>
 #include <reset_manager.h>
 
 #include <stdint.h>
 #include <stdbool.h>
 
-// A virtual memory device, implemented as a byte vector
+// A virtual memory device, implemented as a byte vector. The bytes either
+// directly follow the memory object, or (for ROMs) live in a ROM image.
 typedef struct memory {
 	size_t size;
 	bool writeable;
-	uint8_t bytes[];
+	uint8_t * nonnull /*unowned*/ bytes;
+	romimage_t * nullable /*strong*/ image;
 } memory_t;
 
 // Allocates and initializes a new reference-counted memory object
@@ -19,6 +22,14 @@ memory_t * nullable memory_new (reset_manager_t * nonnull rm,
 				size_t size,
 				bool writeable);
 
+// Creates a new read-only memory object whose contents are the `size` bytes
+// of `image` starting at `start`, without copying them. Returns NULL (after
+// printing an error) if `image` is too short.
+memory_t * nullable memory_new_view (romimage_t * nonnull image,
+				     const char * nonnull path,
+				     size_t start,
+				     size_t size);
+
 // Maps a `size` region of `mem` (starting at `start`) to `bus` (starting at
 // `bus_start`)
 void memory_map (memory_t * nonnull mem,
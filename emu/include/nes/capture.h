@@ -0,0 +1,100 @@
+#pragma once
+
+// A capture records every frame the PPU draws to a file, from a writer thread
+// of its own, so that emulation never waits on the disk. Frames are handed
+// over through a bounded queue: the emulation thread only ever copies a frame
+// into a free slot, and if there isn't one (because the disk has fallen
+// behind), the frame is dropped and counted rather than waited for.
+//
+// Captures are written in a lossless format of Hawknest's own, which keeps the
+// PPU's 9-bit palette indices rather than colors (`scripts/hkvc.py` decodes
+// it). All numbers are little-endian:
+//
+// - A header of the magic "HKVC", a 1-byte version (1), the 2-byte width and
+//   height, and the 512 sRGB colors the palette indices stand for.
+// - Each frame, as its 4-byte frame number, the 4-byte length of its data,
+//   and then its data: pairs of a 2-byte run length and a 2-byte palette
+//   index, which cover every pixel in order. A run of
+//   `CAPTURE_RUN_UNCHANGED` repeats the previous frame in the file (or, in
+//   the first frame, pixels that have never been drawn to).
+//
+// Frames are encoded relative to the previous one using the PPU's dirty
+// tiles, so the writer only compares the pixels in tiles that changed.
+
+#include <base.h>
+#include <nes/ppu.h>
+#include <nes/video.h>
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define CAPTURE_VERSION 1
+#define CAPTURE_QUEUE_LEN 16
+#define CAPTURE_RUN_UNCHANGED 0xFFFF
+
+typedef struct capture_slot {
+	size_t framenum;
+	// The tiles that changed since the frame before it in the queue
+	video_dirty_t dirty;
+	uint16_t frame[PPU_OUTPUT_HEIGHT][PPU_OUTPUT_WIDTH];
+} capture_slot_t;
+
+typedef struct capture {
+	FILE * nonnull /*owned*/ f;
+	const char * nonnull /*unowned*/ path;
+
+	// A single-producer, single-consumer ring: `head` is only advanced by
+	// the emulation thread, once the slot it passes over is filled, and
+	// `tail` only by the writer thread, once it's done with the slot
+	capture_slot_t slots[CAPTURE_QUEUE_LEN];
+	atomic_size_t head;
+	atomic_size_t tail;
+
+	// Wakes the writer thread when the queue stops being empty. It's never
+	// held while writing.
+	pthread_mutex_t lock;
+	pthread_cond_t nonempty;
+
+	pthread_t thread;
+	bool running;
+	atomic_bool stopping;
+
+	atomic_size_t nsubmitted;
+	atomic_size_t ndropped;
+	atomic_size_t nwritten;
+	atomic_size_t nbytes;
+	atomic_size_t max_depth;
+	atomic_bool failed;
+
+	// Only touched by the emulation thread: the tiles that have changed
+	// since the last frame queued, including in any frames dropped since
+	video_dirty_t pending_dirty;
+
+	// Only touched by the writer thread: the last frame written, which
+	// the next is encoded relative to, and the buffer it's encoded into
+	uint16_t prev[PPU_OUTPUT_HEIGHT][PPU_OUTPUT_WIDTH];
+	uint16_t runs[PPU_OUTPUT_HEIGHT * PPU_OUTPUT_WIDTH * 2];
+} capture_t;
+
+// Allocates a new reference-counted capture into a new file at `path`, writes
+// its header (with the colors in `palette`), and starts its writer thread.
+// Returns NULL (after printing an error) if any of that fails.
+capture_t * nullable capture_new (const char * nonnull path, const video_palette_t * nonnull palette);
+
+// Queues a copy of `frame` to be written, or drops it if the queue is full.
+// `dirty` marks the tiles that changed since the last frame submitted. Must
+// only be called from one thread.
+void capture_submit (capture_t * nonnull capture,
+		     size_t framenum,
+		     const uint16_t (* nonnull frame)[PPU_OUTPUT_WIDTH],
+		     const video_dirty_t * nonnull dirty);
+
+// Writes out every frame still queued, stops the writer thread, and flushes
+// the file. This happens automatically when the capture is released, but must
+// be done before exiting while it's still alive.
+void capture_stop (capture_t * nonnull capture);
+
+// Prints how many frames have been submitted, written, and dropped, along with
+// how full the queue has gotten
+void capture_print_stats (capture_t * nonnull capture);
@@ -6,6 +6,7 @@
 // to quickly update the list of onscreen sprites for the PPU.
 
 #include <membus.h>
+#include <nes/ppu.h>
 #include <timekeeper.h>
 #include <mos6502/mos6502.h>
 
@@ -30,18 +31,25 @@ typedef enum controller_button {
 
 typedef struct io_reg {
 	mos6502_t * nonnull /*unowned*/ cpu;
+	ppu_t * nonnull /*strong*/ ppu;
 	bool controller_strobe;
 	uint8_t controller_shiftregs[2];
 	SDL_Scancode controller_mappings[CONTROLLER_NBUTTONS][2];
 } io_reg_t;
 
 // Creates a new "IO Register Device", which encompasses the memory-mapped IO
-// registers we implement
-io_reg_t * nullable io_reg_new (reset_manager_t * nonnull rm, mos6502_t * nonnull cpu, const char * nonnull cscheme_path);
+// registers we implement. `ppu` is the target of OAMDMA transfers.
+io_reg_t * nullable io_reg_new (reset_manager_t * nonnull rm,
+				mos6502_t * nonnull cpu,
+				ppu_t * nonnull ppu,
+				const char * nonnull cscheme_path);
 
 // Maps an `io_reg_t` to the appropriate part of a CPU memory bus
 void io_reg_map (io_reg_t * nonnull io, membus_t * nonnull bus);
 
 // Creates a new `io_reg_t` via `io_reg_new`, and then maps it via `io_reg_map`
 // to `cpu->bus`
-int io_reg_setup (reset_manager_t * nonnull rm, mos6502_t * nonnull cpu, const char * nonnull cscheme_path);
+int io_reg_setup (reset_manager_t * nonnull rm,
+		  mos6502_t * nonnull cpu,
+		  ppu_t * nonnull ppu,
+		  const char * nonnull cscheme_path);
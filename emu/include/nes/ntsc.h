@@ -0,0 +1,53 @@
+#pragma once
+
+// Emulates the composite video the NES actually produced: each pixel becomes
+// the square wave the PPU would have put out for it (8 samples at 12 times the
+// color subcarrier's phase resolution, with emphasis attenuating parts of it),
+// and the resulting signal is decoded back into RGB the way a TV would, by
+// demodulating a window of one subcarrier cycle around each output pixel.
+// Neighbouring pixels bleed into each other's colors as they did on real
+// hardware, and the subcarrier's phase shifts from line to line and frame to
+// frame.
+//
+// Since decoding is linear in the signal, and each output pixel's window only
+// spans the PPU pixel under it and its neighbours on either side, the filter is
+// precomputed into a kernel: the RGB that each possible pixel contributes to
+// each output pixel it reaches, for each phase it can start at. Filtering a
+// frame is then just summing three kernel entries per output pixel, which is
+// done four channels at a time.
+
+#include <base.h>
+#include <nes/ppu.h>
+
+// Output pixels per PPU pixel
+#define NTSC_MAX_SCALE 2
+// The PPU pixels whose signal reaches each output pixel
+#define NTSC_TAPS 3
+
+typedef struct ntsc {
+	int scale;
+
+	// The fixed-point (8 fractional bits) RGBA that the pixel `tap - 1`
+	// away from an output pixel contributes to it, by the output pixel's
+	// position within the PPU pixel under it, and the phase (in units of
+	// 4 samples) that the PPU pixel under it starts at. Pixels that have
+	// never been drawn to are black.
+	int32_t kernels[NTSC_MAX_SCALE][3][NTSC_TAPS][PPU_PIXEL_BLANK + 1][4];
+} ntsc_t;
+
+// Allocates a new reference-counted filter, producing `scale` (1 or 2) output
+// pixels across for each of the PPU's
+ntsc_t * nonnull ntsc_new (int scale);
+
+// Filters `frame` (numbered `framenum`, which sets its subcarrier phase) into
+// RGBA32 texels, `PPU_OUTPUT_WIDTH * scale` wide, with rows `pitch` bytes
+// apart
+void ntsc_filter (const ntsc_t * nonnull ntsc,
+		  size_t framenum,
+		  const uint16_t (* nonnull frame)[PPU_OUTPUT_WIDTH],
+		  uint8_t * nonnull texels,
+		  size_t pitch);
+
+// Measures and prints how many frames per second the filter gets through at
+// each scale
+void ntsc_benchmark (void);
@@ -2,48 +2,57 @@
 
 #include <membus.h>
 #include <timekeeper.h>
+#include <nes/video.h>
+#include <nes/ppu_trace.h>
 #include <mos6502/mos6502.h>
 
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #define PPU_OUTPUT_WIDTH 256
 #define PPU_OUTPUT_HEIGHT 240
 #define PPU_CLKDIVISOR 4
 
-typedef enum ppu_vram_addr_inc {
-	PPU_VRAM_ADDR_INC_1 = 0,
-	PPU_VRAM_ADDR_INC_32 = 1,
-} PACKED ppu_vram_addr_inc_t;
-
-typedef enum ppu_chr_baseaddr {
-	PPU_CHR_BASEADDR_0000 = 0,
-	PPU_CHR_BASEADDR_1000 = 1,
-} PACKED ppu_chr_baseaddr_t;
-
-typedef enum ppu_nt_baseaddr {
-	PPU_NT_BASEADDR_2000 = 0,
-	PPU_NT_BASEADDR_2400 = 1,
-	PPU_NT_BASEADDR_2800 = 2,
-	PPU_NT_BASEADDR_2C00 = 3,
-} PACKED ppu_nt_baseaddr_t;
-
-typedef enum ppu_spritesize {
-	PPU_SPRITESIZE_8x8 = 0,
-	PPU_SPRITESIZE_8x16 = 1,
-} ppu_spritesize_t;
-
-typedef struct ppu_spriteattr {
-	uint8_t palette : 2;
-	uint8_t : 3;
-	bool behind_bg : 1;
-	bool horiz_flipped : 1;
-	bool verti_flipped : 1;
-} ppu_spriteattr_t;
+// PPUCTRL bits. The nametable select bits (0-1) are kept in `tmp_vram_addr`
+// rather than in `ppu->ctrl`.
+#define PPU_CTRL_VRAM_ADDR_INC_32 0x04
+#define PPU_CTRL_SPRITE_CHR_1000  0x08
+#define PPU_CTRL_BG_CHR_1000      0x10
+#define PPU_CTRL_SPRITESIZE_8x16  0x20
+#define PPU_CTRL_NMI_EN           0x80
+
+// PPUMASK bits
+#define PPU_MASK_GREYSCALE      0x01
+#define PPU_MASK_LEFT_BG_EN     0x02
+#define PPU_MASK_LEFT_SPRITE_EN 0x04
+#define PPU_MASK_BG_EN          0x08
+#define PPU_MASK_SPRITE_EN      0x10
+#define PPU_MASK_EMPH           0xE0
+#define PPU_MASK_RENDERING_EN   (PPU_MASK_BG_EN | PPU_MASK_SPRITE_EN)
+
+// PPUSTATUS bits, in the positions the CPU reads them from
+#define PPU_STATUS_SPRITE_OVERFLOW 0x20
+#define PPU_STATUS_SPRITE0_HIT     0x40
+#define PPU_STATUS_VBLANK          0x80
+
+// Fields of the VRAM address registers, which double as the scroll position
+// while rendering
+#define PPU_VRAM_COARSE_X 0x001F
+#define PPU_VRAM_COARSE_Y 0x03E0
+#define PPU_VRAM_NT       0x0C00
+#define PPU_VRAM_FINE_Y   0x7000
+
+// Sprite attribute bits
+#define PPU_SPRITEATTR_PALETTE       0x03
+#define PPU_SPRITEATTR_BEHIND_BG     0x20
+#define PPU_SPRITEATTR_HORIZ_FLIPPED 0x40
+#define PPU_SPRITEATTR_VERTI_FLIPPED 0x80
 
 typedef struct ppu_sprite {
 	uint8_t ypos;
 	uint8_t tile;
-	ppu_spriteattr_t attr;
+	uint8_t attr;
 	uint8_t xpos;
 } ppu_sprite_t;
 
@@ -54,107 +63,328 @@ typedef struct ppu_pixel {
 	bool emph_blue        : 1;
 } PACKED ppu_pixel_t;
 
-typedef struct ppu {
-	struct membus * nonnull /*strong*/ bus;
-	struct mos6502 * nonnull /*unowned*/ cpu;
+// The value of a pixel in `ppu->framebuf` that has never been drawn to, which
+// is output as transparent black
+#define PPU_PIXEL_BLANK 0x200
+
+// Rows of pattern table data ($0000-$1FFF on the PPU bus), pre-decoded into 8
+// 2-bit pixels each, with the leftmost pixel in the low bits. Rows are stored
+// both as-is and horizontally flipped, and are indexed by tile and row number
+// (i.e. by their address on the bus, ignoring which bitplane it's in). Each
+// page of rows is decoded from whatever memory the page was mapped to when it
+// was first used, and is tagged with it; remapping a CHR bank changes the tag
+// and so invalidates exactly the pages that moved. Writes through PPUDATA
+// clear the tag directly, since they change the memory but not the mapping.
+typedef struct ppu_chr_cache {
+	const uint8_t * nullable /*unowned*/ srcs[0x2000 / MEMBUS_PAGESIZE];
+	uint16_t rows[2][0x2000 / 2];
+} ppu_chr_cache_t;
+
+// The sprites found by sprite evaluation on each visible scanline: the first 8
+// in OAM order that are in range (at most 8 can be rendered on a line). This
+// only depends on OAM and the sprite size, so rather than searching all of OAM
+// on every line, it's rebuilt when either has changed since it was last used.
+typedef struct ppu_sprite_buckets {
+	uint8_t spritenums[PPU_OUTPUT_HEIGHT][8];
+	uint8_t nsprites[PPU_OUTPUT_HEIGHT];
+	bool stale;
+} ppu_sprite_buckets_t;
+
+// How many register writes, and how many OAMDMA pages, can be waiting for the
+// PPU thread at once
+#define PPU_LOG_LEN 4096
+#define PPU_LOG_DMA_LEN 8
+
+// The register number logged for an OAMDMA transfer
+#define PPU_LOG_OAMDMA 8
+
+typedef struct ppu_log_entry {
+	uint64_t cyclenum;
+	uint8_t regnum;
+	uint8_t val;
+} ppu_log_entry_t;
+
+// The state shared with the PPU thread, in the (experimental) mode where the
+// PPU is emulated on a thread of its own. The CPU doesn't touch the PPU
+// directly, but logs each write to its registers (along with the cycle it
+// happened on) for the PPU thread to apply once it has caught up to that
+// cycle. The CPU only waits for the PPU when it's about to observe it: on
+// reading a register, on the cycle vblank begins (when NMI may be raised), on
+// toggling NMI, and before anything (e.g. a mapper) changes the PPU's bus.
+typedef struct ppu_worker {
+	// A single-producer, single-consumer ring of register writes: `head`
+	// is only advanced by the CPU thread, once the entry it passes over is
+	// filled, and `tail` only by the PPU thread, once it has applied it.
+	// OAMDMA transfers copy their page into `dma_pages` (likewise a ring,
+	// in the same order) before being logged.
+	ppu_log_entry_t log[PPU_LOG_LEN];
+	atomic_size_t head;
+	atomic_size_t tail;
+	uint8_t dma_pages[PPU_LOG_DMA_LEN][256];
+	size_t dma_head;
+	atomic_size_t dma_tail;
+
+	// The cycle the CPU has reached, as of the last time it said so. No
+	// write will ever be logged before it, so the PPU thread is free to
+	// run up to it.
+	_Atomic uint64_t horizon;
+
+	// To wait for the PPU, the CPU thread bumps `sync_seq` (after moving
+	// the horizon up to the current cycle), and the PPU thread copies it
+	// into `acked_seq` once it has applied every write and reached the
+	// horizon
+	atomic_size_t sync_seq;
+	atomic_size_t acked_seq;
+
+	// Set by the PPU thread, for the CPU thread to act on the next time it
+	// waits for the PPU
+	bool nmi_pending;
+	bool quit_pending;
+
+	// Either thread spins for a while waiting on the other (if there's
+	// another core for it to be running on), and then goes to sleep:
+	// `wake` wakes the PPU thread once there's something to do, and
+	// `acked` the CPU thread once it's been waited for
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t acked;
+	atomic_bool sleeping;
+	atomic_bool waiting;
+	size_t nspins;
+
+	pthread_t thread;
+	bool running;
+	atomic_bool stopping;
+
+	// Only touched by the CPU thread: PPUCTRL's NMI enable as last
+	// written, a timer that moves the horizon up every scanline, and
+	// statistics
+	bool nmi_en;
+	uint64_t horizon_countdown;
+	size_t nlogged;
+	size_t nsyncs;
+} ppu_worker_t;
+
+// How long (in dots) A12 must have been low for a rise to count as an edge.
+// The MMC3 waits for 3 falling edges of M2 (9 dots), which skips the low
+// nametable fetches between one tile's pattern fetches and the next's.
+#define PPU_A12_FILTER_DOTS 9
+
+// A mapper watching the PPU's address bus, through one of the two routines
+// (see `ppu_watch_a12()` and `ppu_watch_fetches()`). Both are called from
+// wherever the PPU is emulated, which, since that happens lazily, may be some
+// time after the cycle they're given.
+typedef struct ppu_watcher {
+	void * nullable /*strong*/ obj;
+	void (* nullable a12_rise)(void * nonnull obj, uint64_t cyclenum);
+	void (* nullable fetch)(void * nonnull obj, uint16_t addr, uint64_t cyclenum);
+
+	// The level of A12 as of the last fetch, and the cycle it last fell on
+	bool a12_high;
+	uint64_t a12_fell_cyclenum;
+} ppu_watcher_t;
 
-	size_t framenum;
-	uint64_t clk_countdown;
+typedef struct ppu {
+	// The state touched on every dot comes first, all of it as plain
+	// integers (or flags of their own), so that updating any of it is a
+	// single store
 
 	size_t slnum;
 	size_t dotnum;
-	size_t overflow_dotnum;
 
-	struct SDL_Window * nonnull /*owned*/ win;
-	struct SDL_Renderer * nonnull /*owned*/ rend;
-	struct SDL_Texture * nonnull /*owned*/ tex;
+	uint8_t ctrl;
+	uint8_t mask;
+	uint8_t status;
+	uint8_t fine_xscroll;
 
-	uint8_t * nonnull /*unowned*/ texdata;
-	size_t texpitch;
+	bool write_toggle;
+	bool sprite0_hit_shouldset;
+	bool next_scanline_has_sprite0;
+	bool scanline_has_sprite0;
 
-	// Mask register
-	union {
-		struct {
-			bool greyscale_en   : 1;
-			bool left_bg_en     : 1;
-			bool left_sprite_en : 1;
-			bool bg_en          : 1;
-			bool sprite_en      : 1;
-			bool emph_red       : 1;
-			bool emph_green     : 1;
-			bool emph_blue      : 1;
-		};
-		uint8_t mask;
-	};
+	// Whether the frame being emulated is left undrawn, which is worked
+	// out once at its start, so that every line of it is treated the same
+	// whether it's emulated a dot or a scanline at a time
+	bool frame_skipped;
 
-	// Various small registers & flags
-	struct {
-		ppu_vram_addr_inc_t vram_addr_inc      : 1;
-		ppu_chr_baseaddr_t bg_chr_baseaddr     : 1;
-		ppu_chr_baseaddr_t sprite_chr_baseaddr : 1;
-		ppu_spritesize_t spritesize            : 1;
+	uint16_t vram_addr;
+	uint16_t tmp_vram_addr;
 
-		bool nmi_en          : 1;
-		bool vblank          : 1;
-		bool sprite0_hit     : 1;
-		bool sprite_overflow : 1;
-		bool write_toggle    : 1;
+	// Bitmap data is kept in the same 2-bit-per-pixel form used by
+	// `ppu_chr_cache_t`, so shifting by a pixel shifts by two bits
+	uint8_t nt_latch, attr_latch;
+	uint16_t bmp_latch;
 
-		bool sprite0_hit_shouldset : 1;
+	uint32_t bg_bmp_shiftreg;
+	uint8_t bg_attr_shiftregs[2];
+	uint8_t bg_palette;
 
-		bool next_scanline_has_sprite0 : 1;
-		bool scanline_has_sprite0      : 1;
-	};
+	uint16_t sprite_bmp_shiftregs[8];
+	uint8_t sprite_attrs[8];
+	uint8_t sprite_xs[8];
 
-	union {
-		struct {
-			uint8_t coarse_xscroll        : 5;
-			uint8_t coarse_yscroll        : 5;
-			ppu_nt_baseaddr_t nt_baseaddr : 2;
-			uint8_t fine_yscroll          : 3;
-		} PACKED;
-		uint16_t vram_addr;
-	};
+	size_t overflow_dotnum;
+	size_t framenum;
+
+	// Only 1 in every `frameskip` frames is drawn and sent to `video`
+	// (and none at all if it discards them). The others still emulate
+	// everything the CPU can observe (vblank, the sprite 0 hit and
+	// overflow flags, and the VRAM address), but skip compositing.
+	size_t frameskip;
+
+	// The PPU is emulated lazily: `synced_cyclenum` is the system clock
+	// cycle of the last dot that was actually emulated, and the PPU is
+	// caught up to the current cycle (by `ppu_sync()`) whenever its state
+	// becomes observable. `clk_countdown` is a timer that only fires at
+	// the start of vblank, when the frame is presented and NMI raised.
+	uint64_t synced_cyclenum;
+	uint64_t clk_countdown;
+
+	struct membus * nonnull /*strong*/ bus;
+	struct mos6502 * nonnull /*unowned*/ cpu;
+
+	// Direct pointers to the memory behind each nametable ($2000, $2400,
+	// $2800, $2C00) and pattern table ($0000, $1000) on `bus`, or NULL
+	// where it isn't plain, contiguous memory. These are resolved by
+	// `ppu_remap()`, as is whether any of those pages are handler-mapped.
+	const uint8_t * nullable /*unowned*/ nt_mem[4];
+	const uint8_t * nullable /*unowned*/ chr_mem[2];
+	bool fetches_unobserved;
+
+	uint8_t eval_nsprites;
+	ppu_sprite_t eval_sprites[8];
+
+	uint8_t palette_mem[32];
+	// `palette_mem` as greyscale mode sees it (with only the brightness
+	// of each color), kept up to date alongside it, so that greyscale is
+	// a choice of table rather than a mask on every pixel
+	uint8_t palette_grey[32];
+
+	// The state only touched once per line or frame, or by the CPU
 
 	uint8_t vram_read_buf;
+	uint8_t oam_addr;
 
-	union {
-		struct {
-			uint8_t tmp_coarse_xscroll        : 5;
-			uint8_t tmp_coarse_yscroll        : 5;
-			ppu_nt_baseaddr_t tmp_nt_baseaddr : 2;
-			uint8_t tmp_fine_yscroll          : 3;
-		} PACKED;
-		uint16_t tmp_vram_addr;
-	};
+	video_sink_t video;
 
-	uint8_t fine_xscroll;
+	// Where the hash (see `ppu_frame_hash()`) of each frame drawn is
+	// written, as a line with its frame number. Frames are drawn for this
+	// even if the video sink would discard them.
+	FILE * nullable /*owned*/ frame_hashes;
 
-	uint8_t bmp_latch[2], nt_latch, attr_latch;
+	// Records every frame drawn, which are likewise drawn for it
+	struct capture * nullable /*strong*/ capture;
 
-	uint16_t bg_bmp_shiftregs[2];
-	uint8_t bg_attr_shiftregs[2];
-	uint8_t bg_palette;
+	// Keeps the PPU's most recent timing events, if they're being traced
+	ppu_trace_t * nullable /*strong*/ trace;
 
-	uint8_t sprite_bmp_shiftregs[8][2];
-	ppu_spriteattr_t sprite_attrs[8];
-	uint8_t sprite_xs[8];
+	// Emulation exits once this many frames have been (if it's nonzero)
+	size_t nframes;
 
-	uint8_t eval_nsprites;
-	ppu_sprite_t eval_sprites[8];
+	// The PPU thread, if the PPU is emulated on one
+	ppu_worker_t * nullable /*strong*/ worker;
+
+	// The mapper watching the PPU's address bus, if any
+	ppu_watcher_t watcher;
 
-	uint8_t oam_addr;
 	union {
 		ppu_sprite_t sprites[64];
 		uint8_t oam[sizeof(ppu_sprite_t) * 64];
 	};
+	ppu_sprite_buckets_t sprite_buckets;
 
-	uint8_t palette_mem[32];
-	uint8_t palette_srgb[512][3];
+	ppu_chr_cache_t chr_cache;
+
+	// The tiles of `framebuf` that have changed since the last frame was
+	// presented, which are marked as they're drawn, and those that had
+	// changed in that frame, which are what's sent along with it
+	video_dirty_t dirty;
+	video_dirty_t presented_dirty;
+
+	// The frame being drawn, as 9-bit palette indices laid out like
+	// `ppu_pixel_t` (6 bits of color and 3 of emphasis), which index the
+	// video sink's palette. Frames are only converted to RGBA when
+	// presented.
+	uint16_t framebuf[PPU_OUTPUT_HEIGHT][PPU_OUTPUT_WIDTH];
 } ppu_t;
 
-// Allocates and initializes a new reference-counted PPU
-ppu_t * nullable ppu_new (reset_manager_t * nonnull rm, mos6502_t * nonnull cpu, int scale);
+// Allocates and initializes a new reference-counted PPU, sending its frames to
+// the video sink described by `video`, which colors them with `palette`
+ppu_t * nullable ppu_new (reset_manager_t * nonnull rm,
+			  mos6502_t * nonnull cpu,
+			  const video_config_t * nonnull video,
+			  video_palette_t * nonnull palette);
 
 // Creates the page mappings on the CPU's memory bus for the PPU registers
 void ppu_map (ppu_t * nonnull ppu);
+
+// Re-resolves the PPU's direct pointers into nametable and pattern table
+// memory. Anything that changes the mappings on the PPU's bus must call this
+// afterwards; until it's first called, every fetch goes through the bus.
+void ppu_remap (ppu_t * nonnull ppu);
+
+// Emulates every dot up to the current system clock cycle (or, if the PPU has
+// a thread of its own, waits for it to). This happens automatically when the
+// CPU accesses the PPU's registers, but anything else that is about to change
+// or look at state visible to the PPU (e.g. a mapper switching CHR banks) must
+// call this first.
+void ppu_sync (ppu_t * nonnull ppu);
+
+// Stops the PPU thread (if any), and closes all of the PPU's outputs (the video
+// sink, frame hashes, and capture), finishing anything they have left to
+// write, and dumps the trace (if any). This happens automatically when the PPU
+// is released, but must be done before exiting while it's still alive.
+void ppu_finish (ppu_t * nonnull ppu);
+
+// Has `rise` called with `obj` (which is retained) and the clock cycle of each
+// rising edge of the PPU's A12 address line, e.g. for a mapper that counts
+// scanlines. Edges are filtered like the MMC3 does, so this is usually once per
+// rendered scanline. Unlike watching every fetch, this doesn't stop scanlines
+// from being emulated all at once. Returns a nonzero exit code (after printing
+// an error) if the PPU has a thread of its own.
+int ppu_watch_a12 (ppu_t * nonnull ppu, void * nonnull obj, void * nonnull rise);
+
+// Has `fetch` called with `obj` (which is retained), and each address the PPU
+// puts on its bus and the clock cycle it does so on. This makes every dot of
+// rendering be emulated one at a time, so it should only be used by mappers
+// that need it. Returns a nonzero exit code (after printing an error) if the
+// PPU has a thread of its own.
+int ppu_watch_fetches (ppu_t * nonnull ppu, void * nonnull obj, void * nonnull fetch);
+
+// Switches the video sink to coloring frames with `palette` (if it colors them
+// at all), from the next frame on, without resetting anything. Frames already
+// being recorded keep the palette they were started with.
+void ppu_set_palette (ppu_t * nonnull ppu, video_palette_t * nonnull palette);
+
+// Returns the 64-bit hash of the framebuffer's contents, as laid out in memory
+uint64_t ppu_frame_hash (ppu_t * nonnull ppu);
+
+// A read-only view of the PPU's video memory, pointing straight into it rather
+// than copying any of it. The pointers last as long as the PPU, but what they
+// point to only holds still until emulation resumes.
+typedef struct ppu_view {
+	// All 64 sprites in OAM, and the same 256 bytes as OAMDATA sees them
+	const ppu_sprite_t * nonnull sprites;
+	const uint8_t * nonnull oam;
+
+	// The 32 bytes of palette memory ($3F00-$3F1F). The bytes for $3F10,
+	// $3F14, $3F18, and $3F1C are unused, since those addresses mirror
+	// $3F00, $3F04, $3F08, and $3F0C.
+	const uint8_t * nonnull palette;
+
+	// The 1 KiB behind each nametable ($2000, $2400, $2800, and $2C00),
+	// or NULL where it isn't plain memory (and so can't be looked at
+	// without going through the PPU's bus)
+	const uint8_t * nullable nametables[4];
+} ppu_view_t;
+
+// Catches the PPU up (see `ppu_sync()`), and returns a view of its video
+// memory. Unlike reading it through OAMDATA or PPUDATA, this leaves OAMADDR,
+// the VRAM address, and the read buffer alone, so it's safe to use on a game
+// that's running.
+ppu_view_t ppu_view (ppu_t * nonnull ppu);
+
+// Copies a page of sprite data into OAM, starting at the current OAMADDR and
+// wrapping around, exactly as 256 successive writes to OAMDATA would. This is
+// the PPU half of an OAMDMA transfer.
+void ppu_oam_dma (ppu_t * nonnull ppu, const uint8_t * nonnull src);
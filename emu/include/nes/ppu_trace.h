@@ -0,0 +1,85 @@
+#pragma once
+
+// A PPU trace keeps the most recent `PPU_TRACE_LEN` timing-related events the
+// PPU goes through (vblank, NMI, sprite 0 hits, and so on), as fixed-size
+// binary records in a ring, for debugging raster timing. Recording one is a
+// single store, so tracing doesn't slow emulation down enough to change what
+// it's being used to look at. Nothing is written until the trace is dumped.
+//
+// Dumps are written in a format of Hawknest's own (`scripts/pputrace.py`
+// converts them to the Chrome trace event format, for Perfetto or
+// chrome://tracing). All numbers are little-endian:
+//
+// - A header of the magic "HKPT", a 1-byte version (1), the 1-byte size of a
+//   record (16), the 2-byte number of master clock cycles per PPU dot, and
+//   the 8-byte number of events recorded in all (including any that have
+//   since been overwritten).
+// - Each record still in the ring, oldest first, laid out as
+//   `ppu_trace_record_t`.
+
+#include <base.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PPU_TRACE_VERSION 1
+
+// The number of records kept (a power of 2), which takes 16 MiB
+#define PPU_TRACE_LEN (1 << 20)
+
+typedef enum ppu_trace_event {
+	// The vblank flag was set, or cleared (by the pre-render scanline,
+	// or by reading PPUSTATUS)
+	PPU_TRACE_VBLANK_SET   = 0,
+	PPU_TRACE_VBLANK_CLEAR = 1,
+	// NMI was raised
+	PPU_TRACE_NMI          = 2,
+	// The sprite 0 hit or sprite overflow flag was set
+	PPU_TRACE_SPRITE0_HIT  = 3,
+	PPU_TRACE_OVERFLOW     = 4,
+	// The CPU read or wrote register `regnum`, and `val` is the byte
+	PPU_TRACE_READ         = 5,
+	PPU_TRACE_WRITE        = 6,
+	// A page was copied into OAM, starting at OAMADDR (`val`)
+	PPU_TRACE_OAMDMA       = 7,
+	// The CPU loaded the VRAM address (`val`) through PPUADDR. The
+	// increments made by accessing PPUDATA, and by rendering, aren't
+	// recorded.
+	PPU_TRACE_VRAM_ADDR    = 8,
+} ppu_trace_event_t;
+
+typedef struct ppu_trace_record {
+	// The master clock cycle of the dot the event happened on
+	uint64_t cyclenum;
+	uint16_t slnum;
+	uint16_t dotnum;
+	uint16_t val;
+	uint8_t event;
+	uint8_t regnum;
+} ppu_trace_record_t;
+
+_Static_assert(sizeof(ppu_trace_record_t) == 16, "trace records must be 16 bytes");
+
+typedef struct ppu_trace {
+	const char * nonnull /*unowned*/ path;
+
+	// Only touched by whichever thread is emulating the PPU
+	size_t nrecorded;
+	ppu_trace_record_t records[PPU_TRACE_LEN];
+} ppu_trace_t;
+
+// Allocates a new, empty reference-counted trace, which is dumped to `path`.
+// The file isn't opened until then.
+ppu_trace_t * nonnull ppu_trace_new (const char * nonnull path);
+
+// Records an event
+static inline void
+ppu_trace_record (ppu_trace_t * nonnull trace, ppu_trace_record_t record)
+{
+	trace->records[trace->nrecorded++ % PPU_TRACE_LEN] = record;
+}
+
+// Writes every record still in the trace to its file, replacing whatever it
+// held. Returns a nonzero exit code (after printing an error) if it can't.
+int ppu_trace_dump (ppu_trace_t * nonnull trace);
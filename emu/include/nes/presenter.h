@@ -0,0 +1,100 @@
+#pragma once
+
+// The presenter puts the PPU's frames on screen from a thread of its own, so
+// that emulation never waits on the display. The SDL window, renderer, and
+// texture all belong to that thread, which also pumps SDL's events.
+//
+// Completed frames are handed over through a triple buffer: at any moment one
+// buffer is being filled by the emulation thread, one is being shown by the
+// presentation thread, and the third holds the newest complete frame (if the
+// presentation thread hasn't taken it yet). Neither side ever waits on the
+// other. A frame that's replaced by a newer one before it could be shown is
+// counted as dropped, and a vsync that finds no new frame shows the last one
+// again, which is counted as repeated.
+
+#include <base.h>
+#include <nes/ppu.h>
+#include <nes/ntsc.h>
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Set in `presenter->ready` while the frame it names hasn't been taken
+#define PRESENTER_FRESH 0x4
+
+typedef struct presenter {
+	uint16_t frames[3][PPU_OUTPUT_HEIGHT][PPU_OUTPUT_WIDTH];
+	size_t framenums[3];
+
+	// The index of the buffer holding the newest complete frame, plus
+	// `PRESENTER_FRESH`. `writing` is only touched by the emulation
+	// thread, and `reading` only by the presentation thread.
+	atomic_uint ready;
+	unsigned writing;
+	unsigned reading;
+
+	// The colors that frames' 9-bit pixels index, which are read on the
+	// presentation thread whenever a frame is converted for display, with
+	// `lock` held. `recolor` is set when it's replaced, so that the frame
+	// on screen is converted again.
+	video_palette_t * nonnull /*strong*/ palette;
+	atomic_bool recolor;
+
+	// If set, frames are filtered through this instead of being colored
+	// with the palette, which likewise happens on the presentation thread
+	ntsc_t * nullable /*strong*/ ntsc;
+
+	atomic_size_t nsubmitted;
+	atomic_size_t ndropped;
+	atomic_size_t nrepeated;
+
+	// Set by the presentation thread when the window is closed, and by
+	// `presenter_stop()` to end the presentation thread
+	atomic_bool quit_requested;
+	atomic_bool stopping;
+
+	pthread_t thread;
+	bool running;
+
+	// Reports the outcome of setting up video to `presenter_new()`: 0
+	// while the presentation thread is still starting, 1 once it's
+	// running, and -1 if it failed. The lock also guards `palette`.
+	pthread_mutex_t lock;
+	pthread_cond_t started;
+	int status;
+	int scale;
+
+	// Only touched by the presentation thread
+	struct SDL_Window * nullable /*owned*/ win;
+	struct SDL_Renderer * nullable /*owned*/ rend;
+	struct SDL_Texture * nullable /*owned*/ tex;
+} presenter_t;
+
+// Allocates a new reference-counted presenter, and starts its thread, which
+// opens a window `scale` times the size of the PPU's output. Frames are
+// colored with `palette`, unless `ntsc` is nonzero, in which case they're
+// filtered through NTSC video at `ntsc` pixels across for each of the PPU's.
+// Returns NULL (after printing an error) if the window couldn't be set up.
+presenter_t * nullable presenter_new (int scale, int ntsc, video_palette_t * nonnull palette);
+
+// Hands a copy of `frame` (numbered `framenum`) to the presentation thread, to
+// be shown at the next vsync. Must only be called from one thread.
+void presenter_submit (presenter_t * nonnull presenter,
+		       size_t framenum,
+		       const uint16_t (* nonnull frame)[PPU_OUTPUT_WIDTH]);
+
+// Switches to coloring frames with `palette` (keeping a reference to it), and
+// recolors the frame on screen. Unlike submitting, this may briefly wait for the
+// presentation thread to finish converting a frame.
+void presenter_set_palette (presenter_t * nonnull presenter, video_palette_t * nonnull palette);
+
+// Returns whether the user has asked to quit (e.g. by closing the window)
+bool presenter_quit_requested (presenter_t * nonnull presenter);
+
+// Stops the presentation thread and closes the window. This happens
+// automatically when the presenter is released, but must be done before
+// exiting while it's still alive.
+void presenter_stop (presenter_t * nonnull presenter);
+
+// Prints how many frames have been submitted, dropped, and repeated
+void presenter_print_stats (presenter_t * nonnull presenter);
@@ -0,0 +1,148 @@
+#pragma once
+
+// A video sink is wherever the PPU sends the frames it draws. Like memory bus
+// handlers and timers, a sink is a reference-counted object along with the
+// routines to invoke on it. Frames are sent whole, as the 9-bit palette indices
+// in `ppu->framebuf`, and each sink colors them itself (if at all). Along with
+// each frame comes which of its 8x8 tiles differ from the frame sent before
+// it, so that sinks which keep the previous frame around only need to redo the
+// parts of it that changed.
+//
+// A sink without a `write_frame` routine (such as the one for
+// `VIDEO_BACKEND_NONE`) discards every frame, so the PPU doesn't draw any,
+// and only emulates what the CPU can observe.
+
+#include <base.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Must match `PPU_OUTPUT_WIDTH` and `PPU_OUTPUT_HEIGHT`
+#define VIDEO_FRAME_WIDTH 256
+#define VIDEO_FRAME_HEIGHT 240
+
+#define VIDEO_TILE_SIZE 8
+#define VIDEO_TILE_COLS (VIDEO_FRAME_WIDTH / VIDEO_TILE_SIZE)
+#define VIDEO_TILE_ROWS (VIDEO_FRAME_HEIGHT / VIDEO_TILE_SIZE)
+
+// Which of a frame's 8x8 tiles differ from the frame sent before it: bit `x`
+// of `rows[y]` is set if any pixel in the tile `x` tiles across and `y` down
+// did. Tiles may be marked even if they came out the same (e.g. if they were
+// changed in a frame that was skipped, and then changed back), but a tile that
+// isn't marked is always unchanged.
+typedef struct video_dirty {
+	uint32_t rows[VIDEO_TILE_ROWS];
+} video_dirty_t;
+
+_Static_assert(VIDEO_TILE_COLS == 32, "a row of tiles must fit a dirty mask");
+
+// A rectangle of a frame, in pixels
+typedef struct video_rect {
+	uint16_t x, y;
+	uint16_t width, height;
+} video_rect_t;
+
+// The most rectangles that `video_dirty_rects()` can produce, for a
+// checkerboard of dirty tiles
+#define VIDEO_MAX_DIRTY_RECTS (VIDEO_TILE_ROWS * VIDEO_TILE_COLS / 2)
+
+typedef enum video_backend {
+	// Displays frames in a window
+	VIDEO_BACKEND_SDL = 0,
+	// Discards frames without drawing them
+	VIDEO_BACKEND_NONE = 1,
+	// Appends frames to a file as raw RGB24 (e.g. for `ffmpeg -f rawvideo
+	// -pixel_format rgb24 -video_size 256x240`)
+	VIDEO_BACKEND_RAW = 2,
+} video_backend_t;
+
+typedef struct video_config {
+	video_backend_t backend;
+	// The file written by `VIDEO_BACKEND_RAW`
+	const char * nullable raw_path;
+	// The window size of `VIDEO_BACKEND_SDL`, as a multiple of the output
+	int scale;
+	// How many pixels across `VIDEO_BACKEND_SDL` filters each of the
+	// PPU's into through composite NTSC video (see `nes/ntsc.h`), or 0
+	// to color them straight from the palette
+	int ntsc;
+	// Only 1 in every `frameskip` frames is drawn (see `ppu->frameskip`)
+	size_t frameskip;
+	// Where the hash of each frame drawn is written, if anywhere (see
+	// `ppu->frame_hashes`)
+	const char * nullable frame_hashes_path;
+	// Where every frame drawn is recorded, if anywhere (see
+	// `nes/capture.h`)
+	const char * nullable capture_path;
+	// Where the PPU's trace of timing events is dumped, if they're traced
+	// at all (see `nes/ppu_trace.h`)
+	const char * nullable trace_path;
+	// The number of frames to emulate before exiting, or 0 to go on until
+	// the user quits
+	size_t nframes;
+	// Whether the PPU is emulated on a thread of its own (see
+	// `ppu_worker_t`)
+	bool ppu_thread;
+} video_config_t;
+
+// The number of 9-bit pixel values (6 bits of color and 3 of emphasis)
+#define VIDEO_PALETTE_LEN 512
+
+// The sRGB color of each 9-bit pixel value, shared by the sinks that color
+// frames. Emphasis selects one of 8 consecutive tables of 64 colors.
+typedef struct video_palette {
+	// The same colors as RGBA32 texels (R, G, B, and A in memory order),
+	// so that coloring a pixel is a single 32-bit load and store, followed
+	// by transparent black for pixels that have never been drawn to. This
+	// comes first, so that it's as aligned (16 bytes) as the allocation.
+	uint32_t rgba[VIDEO_PALETTE_LEN + 1];
+
+	uint8_t srgb[VIDEO_PALETTE_LEN][3];
+} video_palette_t;
+
+// Loads a new reference-counted palette from the file at `path`, and builds
+// its RGBA table. Returns NULL (after printing an error) if it can't be read.
+video_palette_t * nullable video_palette_load (const char * nonnull path);
+
+// Covers the dirty tiles in `dirty` with rectangles, stored into `rects`
+// (which must have room for `VIDEO_MAX_DIRTY_RECTS`), and returns how many
+// there are. Each run of dirty tiles in a row becomes a
+// rectangle, which is extended down over the runs with the same span in the
+// rows below it.
+size_t video_dirty_rects (const video_dirty_t * nonnull dirty,
+			  video_rect_t * nonnull rects);
+
+typedef struct video_sink {
+	void * nullable /*strong*/ obj;
+
+	// Receives each frame that's drawn, and its number, along with the
+	// tiles that have changed since the last one
+	void (* nullable write_frame)(void * nonnull obj,
+				      size_t framenum,
+				      const uint16_t (* nonnull frame)[VIDEO_FRAME_WIDTH],
+				      const video_dirty_t * nonnull dirty);
+
+	// Switches to coloring frames with `palette` (keeping a reference to
+	// it), from the next frame on. Sinks that don't color frames leave
+	// this unset.
+	void (* nullable set_palette)(void * nonnull obj, video_palette_t * nonnull palette);
+
+	// Returns whether the user has asked to quit (e.g. by closing the
+	// window)
+	bool (* nullable quit_requested)(void * nonnull obj);
+
+	// Finishes up (e.g. flushing output, and reporting statistics) before
+	// the sink is released
+	void (* nullable close)(void * nonnull obj);
+} video_sink_t;
+
+// Opens the sink selected by `config` into `sink`, which keeps a reference to
+// `palette` if it colors frames. Returns a nonzero exit code (after printing an
+// error) if the sink can't be opened.
+int video_sink_open (video_sink_t * nonnull sink,
+		     const video_config_t * nonnull config,
+		     video_palette_t * nonnull palette);
+
+// Closes and releases the sink (if any) in `sink`, leaving it empty
+void video_sink_close (video_sink_t * nonnull sink);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <base.h>
+#include <arena.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -11,14 +12,24 @@ typedef struct rc {
 	size_t weak_count;
 	size_t strong_count;
 	void (*nullable deinit)(void * nonnull obj);
+	arena_t * nullable /*unowned*/ arena;
 } rc_t;
 
 // Allocates a new reference-counted block of memory with a strong reference
 // count of 1 and a weak reference count of 0, and zero-initializes it. If
 // `deinit` is non-null, it is called on the "object" when its reference count
-// hits zero.
+// hits zero. The block is carved out of the calling thread's current arena
+// if one has been selected with `rc_use_arena()` (and it has room), and
+// allocated from the heap otherwise.
 void * nonnull rc_alloc (size_t size, void * nullable deinit);
 
+// Selects the arena that subsequent `rc_alloc()`s on the calling thread are
+// made from, returning the previously selected one. Passing NULL goes back to
+// allocating from the heap. Objects that outlive a single machine (such as
+// shared ROM images) should be allocated with no arena selected. An arena must
+// outlive every object allocated from it.
+arena_t * nullable rc_use_arena (arena_t * nullable arena);
+
 // Increments the strong reference count of `obj`, and returns it.
 void * nonnull rc_retain (void * nonnull obj);
 
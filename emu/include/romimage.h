@@ -0,0 +1,42 @@
+#pragma once
+
+// A ROM image is a read-only memory mapping of a whole ROM file. Memories
+// backing cartridge ROMs are created as views into an image (see
+// `memory_new_view()`), so loading a ROM copies nothing, and every machine
+// (in this process or any other) running the same ROM shares one physical
+// copy of it through the page cache.
+//
+// Within a process, images are also deduplicated: opening a file which is
+// already mapped (and unmodified since) hands back another reference to the
+// existing image. Since images are shared between machines, which may be
+// running on different threads, they must only be retained and released
+// through `romimage_retain()` and `romimage_release()`.
+
+#include <base.h>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+typedef struct romimage {
+	const uint8_t * nonnull /*owned*/ data;
+	size_t size;
+
+	// The identity of the mapped file, used to find existing images
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
+
+	struct romimage * nullable /*unowned*/ next;
+} romimage_t;
+
+// Returns a reference-counted image of the file `f` (opened at `path`). The
+// image is always allocated outside of any arena. Returns NULL (after printing
+// an error) if the file can't be mapped.
+romimage_t * nullable romimage_open (FILE * nonnull f, const char * nonnull path);
+
+// Thread-safe counterparts of `rc_retain()` and `rc_release()` for images
+romimage_t * nonnull romimage_retain (romimage_t * nonnull image);
+void romimage_release (romimage_t * nonnull image);
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <nes/ppu.h>
 #include <mos6502/mos6502.h>
 
 #define PROMPT_STR GREEN(BOLD("(hawknest-shell)$> "))
 
-void run_shell (mos6502_t * nonnull cpu, bool interactive);
+// Runs the Hawknest shell on `cpu`. The PPU is NULL for systems without one,
+// in which case the commands that inspect it are unavailable.
+void run_shell (mos6502_t * nonnull cpu, ppu_t * nullable ppu, bool interactive);
@@ -24,7 +24,8 @@ typedef struct timekeeper {
 } timekeeper_t;
 
 // Constructs a new timekeeper, with the relationship between virtual and real
-// time defined by `clk_period`.
+// time defined by `clk_period`. A `clk_period` of 0 leaves virtual time free
+// to run as fast as it can.
 timekeeper_t * nullable timekeeper_new (reset_manager_t * nonnull rm, double clk_period);
 
 // Registers a new timer with `tk`. `countdown` is a pointer to the countdown
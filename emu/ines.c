@@ -104,7 +104,7 @@ setup_common (reset_manager_t * nonnull rm,
 	      mos6502_t * nonnull cpu,
 	      const char * nonnull palette_path,
 	      const char * cscheme_path,
-	      int scale)
+	      const video_config_t * nonnull video)
 {
 	ppu_t * retval = NULL;
 
@@ -118,31 +118,27 @@ setup_common (reset_manager_t * nonnull rm,
 	// was mirrored at 0x800, 0x1000, and 0x1800
 	memory_map_mirroring(ram, cpu->bus, 0x0800, 0x0800, 0x0000, 3);
 
-	if (io_reg_setup(rm, cpu, cscheme_path)) {
+	video_palette_t * palette = video_palette_load(palette_path);
+	if (!palette) {
 		goto release_ram;
 	}
 
-	ppu_t * ppu = ppu_new(rm, cpu, scale);
+	ppu_t * ppu = ppu_new(rm, cpu, video, palette);
 	if (!ppu) {
-		goto release_ram;
+		goto release_palette;
 	}
 	ppu_map(ppu);
 
-	FILE * f = try_fopen(palette_path, "rb");
-	if (!f) {
+	if (io_reg_setup(rm, cpu, ppu, cscheme_path)) {
 		goto release_ppu;
 	}
 
-	if (try_fread(f, palette_path, ppu->palette_srgb, sizeof(ppu->palette_srgb))) {
-		goto close_f;
-	}
-
 	retval = rc_retain(ppu);
 
-close_f:
-	fclose(f);
 release_ppu:
 	rc_release(ppu);
+release_palette:
+	rc_release(palette);
 release_ram:
 	rc_release(ram);
 ret:
@@ -156,7 +152,8 @@ inesrom_load (FILE * f,
 	      mos6502_t * cpu,
 	      const char * palette_path,
 	      const char * cscheme_path,
-	      int scale)
+	      const video_config_t * video,
+	      ppu_t * nullable * ppu_out)
 {
 	int retcode = -1;
 
@@ -236,10 +233,20 @@ inesrom_load (FILE * f,
 		WARNING_PRINT("%s expects a PAL system", path);
 	}
 
+	// PRGROM and CHROM are views into the file, which immediately follow
+	// the header
+	size_t prgrom_start = (size_t)ftell(f);
+	size_t chrom_start = prgrom_start + prgrom_size;
+
+	romimage_t * image = romimage_open(f, path);
+	if (!image) {
+		goto ret;
+	}
+
 	// Temporary nullable binding
-	ppu_t * ppu = setup_common(rm, cpu, palette_path, cscheme_path, scale);
+	ppu_t * ppu = setup_common(rm, cpu, palette_path, cscheme_path, video);
 	if (!ppu) {
-		goto ret;
+		goto release_image;
 	}
 	info.ppu = ppu;
 
@@ -251,14 +258,14 @@ inesrom_load (FILE * f,
 	}
 
 	if (prgrom_size) {
-		info.prgrom = memory_new(rm, prgrom_size, false);
+		info.prgrom = memory_new_view(image, path, prgrom_start, prgrom_size);
 		if (!info.prgrom) {
 			goto release_wram;
 		}
 	}
 
 	if (chrom_size) {
-		info.chrom = memory_new(rm, chrom_size, false);
+		info.chrom = memory_new_view(image, path, chrom_start, chrom_size);
 		if (!info.chrom) {
 			goto release_prgrom;
 		}
@@ -276,16 +283,6 @@ inesrom_load (FILE * f,
 		goto release_chram;
 	}
 
-	if (info.prgrom &&
-	    try_fread(f, path, info.prgrom->bytes, info.prgrom->size)) {
-		goto release_vram;
-	}
-
-	if (info.chrom &&
-	    try_fread(f, path, info.chrom->bytes, info.chrom->size)) {
-		goto release_vram;
-	}
-
 	switch (mapper) {
 	case 0:
 		retcode = nrom_setup(&info);
@@ -299,7 +296,6 @@ inesrom_load (FILE * f,
 		break;
 	}
 
-release_vram:
 	rc_release((memory_t * nonnull)info.vram);
 release_chram:
 	if (info.chram) {
@@ -318,7 +314,12 @@ release_wram:
 		rc_release((memory_t * nonnull)info.wram);
 	}
 release_ppu:
+	if (!retcode) {
+		*ppu_out = rc_retain(info.ppu);
+	}
 	rc_release(info.ppu);
+release_image:
+	romimage_release((romimage_t * nonnull)image);
 ret:
 	return retcode;
 }
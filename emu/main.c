@@ -1,10 +1,12 @@
 #include <rc.h>
 #include <base.h>
+#include <arena.h>
 #include <ines.h>
 #include <shell.h>
 #include <fileio.h>
 #include <memory.h>
 #include <nes/ppu.h>
+#include <nes/ntsc.h>
 #include <nes/io_reg.h>
 
 #include <SDL2/SDL.h>
@@ -30,14 +32,18 @@ hawknest_rom_load (FILE * nonnull f, const char * nonnull path, reset_manager_t
 {
 	int retcode = 0;
 
-	memory_t * cartrom = memory_new(rm, 0x6000, false);
-	if (!cartrom) {
+	romimage_t * image = romimage_open(f, path);
+	if (!image) {
 		retcode = -1;
 		goto ret;
 	}
-	if ((retcode = try_fread(f, path, cartrom->bytes, cartrom->size))) {
+
+	// The cartridge ROM immediately follows the magic number
+	memory_t * cartrom = memory_new_view(image, path, (size_t)ftell(f), 0x6000);
+	romimage_release(image);
+	if (!cartrom) {
 		retcode = -1;
-		goto release_cartrom;
+		goto ret;
 	}
 	memory_map(cartrom, cpu->bus, 0xA000, (uint16_t)cartrom->size, 0);
 
@@ -61,7 +67,8 @@ load_rom (const char * nonnull path,
 	  mos6502_t * nonnull cpu,
 	  const char * nonnull palette_path,
 	  const char * nonnull cscheme_path,
-	  int scale)
+	  const video_config_t * nonnull video,
+	  ppu_t * nullable * nonnull ppu)
 {
 	int retcode = 0;
 
@@ -81,7 +88,7 @@ load_rom (const char * nonnull path,
 		goto ret1;
 	}
 	else if (!memcmp(magic, ines_magic, sizeof(magic))) {
-		retcode = inesrom_load(f, path, rm, cpu, palette_path, cscheme_path, scale);
+		retcode = inesrom_load(f, path, rm, cpu, palette_path, cscheme_path, video, ppu);
 		goto ret1;
 	}
 
@@ -110,6 +117,17 @@ print_usage (char ** argv)
 	SUGGESTION_PRINT("  " UNBOLD("--palette     ") "or " UNBOLD("-p <path> ") ": Use the NES palette at " UNBOLD("<path>"));
 	SUGGESTION_PRINT("  " UNBOLD("--cscheme     ") "or " UNBOLD("-c <path> ") ": Use the NES controller scheme at " UNBOLD("<path>"));
 	SUGGESTION_PRINT("  " UNBOLD("--scale       ") "or " UNBOLD("-s <int>  ") ": Scale NES output by " UNBOLD("<int>"));
+	SUGGESTION_PRINT("  " UNBOLD("--frameskip   ") "or " UNBOLD("-f <int>  ") ": Draw only 1 in every " UNBOLD("<int>") " frames");
+	SUGGESTION_PRINT("  " UNBOLD("--video       ") "or " UNBOLD("-v <sink> ") ": Send video to " UNBOLD("sdl") " (a window), " UNBOLD("none") ", or " UNBOLD("raw:<path>") " (RGB24 frames)");
+	SUGGESTION_PRINT("  " UNBOLD("--ntsc        ") "or " UNBOLD("-N <int>  ") ": Filter " UNBOLD("sdl") " video through NTSC, at " UNBOLD("<int>") " (1 or 2) times the width");
+	SUGGESTION_PRINT("  " UNBOLD("--ntsc-bench  ") "   " UNBOLD("          ") ": Measure the NTSC filter's throughput, and exit");
+	SUGGESTION_PRINT("  " UNBOLD("--frame-hashes ") "or " UNBOLD("-H <path> ") ": Write the hash of each frame drawn to " UNBOLD("<path>"));
+	SUGGESTION_PRINT("  " UNBOLD("--record      ") "or " UNBOLD("-r <path> ") ": Record every frame drawn to " UNBOLD("<path>"));
+	SUGGESTION_PRINT("  " UNBOLD("--ppu-trace   ") "or " UNBOLD("-t <path> ") ": Trace the PPU's timing events, and dump them to " UNBOLD("<path>") " on exit");
+	SUGGESTION_PRINT("  " UNBOLD("--frames      ") "or " UNBOLD("-n <int>  ") ": Exit after " UNBOLD("<int>") " frames");
+	SUGGESTION_PRINT("  " UNBOLD("--ppu-thread  ") "or " UNBOLD("-T        ") ": Emulate the PPU on a thread of its own (experimental)");
+	SUGGESTION_PRINT("  " UNBOLD("--arena       ") "or " UNBOLD("-a        ") ": Allocate the whole machine from one arena");
+	SUGGESTION_PRINT("  " UNBOLD("--open-bus    ") "or " UNBOLD("-o <model>") ": Model open-bus reads as " UNBOLD("latch") ", " UNBOLD("pullup") ", or " UNBOLD("ignore"));
 	SUGGESTION_PRINT("  " UNBOLD("--help        ") "or " UNBOLD("-h        ") ": Print this message");
 	SUGGESTION_PRINT("  " UNBOLD("--version     ") "or " UNBOLD("-V        ") ": Print version information");
 }
@@ -119,6 +137,17 @@ static struct option long_options[] = {
 	{"palette", required_argument, 0, 'p'},
 	{"cscheme", required_argument, 0, 'c'},
 	{"scale", required_argument, 0, 's'},
+	{"frameskip", required_argument, 0, 'f'},
+	{"video", required_argument, 0, 'v'},
+	{"ntsc", required_argument, 0, 'N'},
+	{"ntsc-bench", no_argument, 0, 'B'},
+	{"frame-hashes", required_argument, 0, 'H'},
+	{"record", required_argument, 0, 'r'},
+	{"ppu-trace", required_argument, 0, 't'},
+	{"frames", required_argument, 0, 'n'},
+	{"ppu-thread", no_argument, 0, 'T'},
+	{"arena", no_argument, 0, 'a'},
+	{"open-bus", required_argument, 0, 'o'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'V'},
 	{0, 0, 0, 0}};
@@ -136,11 +165,17 @@ main (int argc, char ** argv)
 	char * cscheme_path = "cscheme";
 	char * palette_path = "palette";
 	bool interactive = false;
-	int scale = 1;
+	bool use_arena = false;
+	membus_open_bus_t open_bus = MEMBUS_OPEN_BUS_DEFAULT;
+	video_config_t video = {
+		.backend   = VIDEO_BACKEND_SDL,
+		.scale     = 1,
+		.frameskip = 1,
+	};
 
 	while (1) {
 		int opt_idx = 0;
-		int c = getopt_long(argc, argv, "p:c:s:hiV", long_options, &opt_idx);
+		int c = getopt_long(argc, argv, "p:c:s:f:v:N:H:r:t:n:Tao:hiV", long_options, &opt_idx);
 
 		if (c == -1) {
 			break;
@@ -159,7 +194,83 @@ main (int argc, char ** argv)
 			cscheme_path = optarg;
 			break;
 		case 's':
-			scale = atoi(optarg);
+			video.scale = atoi(optarg);
+			break;
+		case 'f':
+			if (atoi(optarg) < 1) {
+				ERROR_PRINT("Frame-skip must be at least 1, not '%s'", optarg);
+				print_usage(argv);
+				goto ret;
+			}
+			video.frameskip = (size_t)atoi(optarg);
+			break;
+		case 'v':
+			if (!strcmp(optarg, "sdl")) {
+				video.backend = VIDEO_BACKEND_SDL;
+			}
+			else if (!strcmp(optarg, "none")) {
+				video.backend = VIDEO_BACKEND_NONE;
+			}
+			else if (!strncmp(optarg, "raw:", 4) && optarg[4]) {
+				video.backend = VIDEO_BACKEND_RAW;
+				video.raw_path = optarg + 4;
+			}
+			else {
+				ERROR_PRINT("Unknown video sink '%s'", optarg);
+				print_usage(argv);
+				goto ret;
+			}
+			break;
+		case 'N':
+			if (atoi(optarg) < 1 || atoi(optarg) > NTSC_MAX_SCALE) {
+				ERROR_PRINT("NTSC resolution must be 1 or 2, not '%s'", optarg);
+				print_usage(argv);
+				goto ret;
+			}
+			video.ntsc = atoi(optarg);
+			break;
+		case 'B':
+			ntsc_benchmark();
+			retcode = 0;
+			goto ret;
+		case 'H':
+			video.frame_hashes_path = optarg;
+			break;
+		case 'r':
+			video.capture_path = optarg;
+			break;
+		case 't':
+			video.trace_path = optarg;
+			break;
+		case 'n':
+			if (atoi(optarg) < 1) {
+				ERROR_PRINT("Frame count must be at least 1, not '%s'", optarg);
+				print_usage(argv);
+				goto ret;
+			}
+			video.nframes = (size_t)atoi(optarg);
+			break;
+		case 'T':
+			video.ppu_thread = true;
+			break;
+		case 'a':
+			use_arena = true;
+			break;
+		case 'o':
+			if (!strcmp(optarg, "latch")) {
+				open_bus = MEMBUS_OPEN_BUS_LATCH;
+			}
+			else if (!strcmp(optarg, "pullup")) {
+				open_bus = MEMBUS_OPEN_BUS_PULLUP;
+			}
+			else if (!strcmp(optarg, "ignore")) {
+				open_bus = MEMBUS_OPEN_BUS_IGNORE;
+			}
+			else {
+				ERROR_PRINT("Unknown open-bus model '%s'", optarg);
+				print_usage(argv);
+				goto ret;
+			}
 			break;
 		case 'V':
 			print_version();
@@ -184,6 +295,11 @@ main (int argc, char ** argv)
 		goto ret;
 	}
 
+	if (video.ntsc && video.backend != VIDEO_BACKEND_SDL) {
+		ERROR_PRINT("NTSC filtering is only done for the sdl video sink");
+		goto ret;
+	}
+
 	uint16_t argc_ext = (uint16_t)(argc - optind);
 	char ** argv_ext = &argv[optind];
 
@@ -192,13 +308,24 @@ main (int argc, char ** argv)
 		goto ret;
 	}
 
+	arena_t * arena = NULL;
+	if (use_arena) {
+		arena = arena_new(ARENA_DEFAULT_SIZE);
+		if (!arena) {
+			ERROR_PRINT("Failed to reserve a machine arena");
+			goto quit_sdl;
+		}
+		rc_use_arena(arena);
+	}
+
 	reset_manager_t * rm = reset_manager_new();
 	if (!rm) {
 		ERROR_PRINT("Failed to create a reset manager");
-		goto quit_sdl;
+		goto free_arena;
 	}
 
-	timekeeper_t * tk = timekeeper_new(rm, 1.0 / NES_NTSC_SYSCLK);
+	// Only run in real time when there's someone watching
+	timekeeper_t * tk = timekeeper_new(rm, video.backend == VIDEO_BACKEND_SDL ? 1.0 / NES_NTSC_SYSCLK : 0.0);
 	if (!tk) {
 		ERROR_PRINT("Failed to create a timekeeper");
 		goto release_rm;
@@ -209,8 +336,10 @@ main (int argc, char ** argv)
 		ERROR_PRINT("Failed to create a CPU");
 		goto release_tk;
 	}
+	membus_set_open_bus(cpu->bus, open_bus);
 
-	if (load_rom(rom_path, rm, cpu, palette_path, cscheme_path, scale)) {
+	ppu_t * ppu = NULL;
+	if (load_rom(rom_path, rm, cpu, palette_path, cscheme_path, &video, &ppu)) {
 		ERROR_PRINT("Couldn't initialize system");
 		goto release_cpu;
 	}
@@ -218,16 +347,24 @@ main (int argc, char ** argv)
 	reset_manager_issue_reset(rm);
 	mos6502_reset(cpu);
 	timekeeper_pause(cpu->tk);
-	run_shell(cpu, interactive);
+	run_shell(cpu, ppu, interactive);
 
 	retcode = 0;
 
+	if (ppu) {
+		rc_release((ppu_t * nonnull)ppu);
+	}
 release_cpu:
 	rc_release(cpu);
 release_tk:
 	rc_release(tk);
 release_rm:
 	rc_release(rm);
+free_arena:
+	if (arena) {
+		rc_use_arena(NULL);
+		arena_free((arena_t * nonnull)arena);
+	}
 quit_sdl:
 	SDL_Quit();
 ret:
@@ -3,6 +3,8 @@
 #include <membus.h>
 #include <reset_manager.h>
 
+#include <string.h>
+
 static void
 deinit (membus_t * nonnull bus)
 {
@@ -14,55 +16,120 @@ deinit (membus_t * nonnull bus)
 static void
 reset (membus_t * nonnull bus)
 {
-	(void)bus; // stop clang/gcc from complaining about `bus` being unused
-#ifndef OPEN_BUS_TO_VCC
 	bus->data_lanes = 0xFF;
-#endif
 }
 
+// Defines a read routine for one open-bus model. Reads from data-mapped pages
+// drive every lane, so only the handler and unmapped paths have to combine
+// `lane_mask` with anything, using `MIX`; data reads just go through `LATCH`.
+#define DEFINE_READ(name, LATCH, MIX)                                                       \
+	static uint8_t                                                                      \
+	name (membus_t * nonnull bus, uint16_t addr)                                       \
+	{                                                                                   \
+		size_t pagenum = addr / MEMBUS_PAGESIZE;                                    \
+		ASSERT(pagenum < MEMBUS_NPAGES);                                            \
+                                                                                            \
+		void * obj = bus->read_mappings[pagenum].obj;                               \
+		size_t offset_p1 = bus->read_mappings[pagenum].offset_p1;                   \
+                                                                                            \
+		if (LIKELY(obj && !offset_p1)) {                                            \
+			uint8_t val = bus->read_mappings[pagenum].data[addr % MEMBUS_PAGESIZE]; \
+			LATCH;                                                              \
+			return val;                                                         \
+		}                                                                           \
+                                                                                            \
+		uint8_t unmixed_val = 0x00;                                                 \
+		uint8_t lane_mask = 0x00;                                                   \
+                                                                                            \
+		if (obj) {                                                                  \
+			uint8_t (* handler)(void * nonnull, size_t, uint8_t *) =            \
+				(__typeof(handler))bus->read_mappings[pagenum].handler;     \
+			size_t final_addr = (size_t)addr % MEMBUS_PAGESIZE + offset_p1 - 1; \
+			lane_mask = 0xFF;                                                   \
+			unmixed_val = handler(obj, final_addr, &lane_mask);                 \
+		}                                                                           \
+                                                                                            \
+		MIX;                                                                        \
+	}
+
+DEFINE_READ(read_latch,
+	    bus->data_lanes = val,
+	    bus->data_lanes &= ~lane_mask;
+	    bus->data_lanes |= unmixed_val;
+	    return bus->data_lanes)
+
+DEFINE_READ(read_pullup,
+	    (void)0,
+	    return unmixed_val | (uint8_t)~lane_mask)
+
+DEFINE_READ(read_ignore,
+	    (void)0,
+	    return unmixed_val & lane_mask)
+
 membus_t *
 membus_new (reset_manager_t * rm)
 {
 	membus_t * bus = rc_alloc(sizeof(membus_t), deinit);
+	membus_set_open_bus(bus, MEMBUS_OPEN_BUS_DEFAULT);
 	reset_manager_add_device(rm, bus, reset);
 	return bus;
 }
 
-uint8_t
-membus_read (membus_t * bus, uint16_t addr)
+void
+membus_set_open_bus (membus_t * bus, membus_open_bus_t open_bus)
+{
+	bus->open_bus = open_bus;
+
+	switch (open_bus) {
+	case MEMBUS_OPEN_BUS_LATCH:
+		bus->read = read_latch;
+		break;
+	case MEMBUS_OPEN_BUS_PULLUP:
+		bus->read = read_pullup;
+		break;
+	case MEMBUS_OPEN_BUS_IGNORE:
+		bus->read = read_ignore;
+		break;
+	default:
+		UNREACHABLE();
+	}
+}
+
+// Reads the 16-bit value whose low byte is at `addr` and whose high byte is at
+// `hi_addr`, which is `addr + 1` unless wrapping within the page
+static inline uint16_t
+read16 (membus_t * nonnull bus, uint16_t addr, uint16_t hi_addr)
 {
 	size_t pagenum = addr / MEMBUS_PAGESIZE;
 	ASSERT(pagenum < MEMBUS_NPAGES);
 
-	void * obj = bus->read_mappings[pagenum].obj;
-	uint8_t * data = bus->read_mappings[pagenum].data;
-	size_t offset_p1 = bus->read_mappings[pagenum].offset_p1;
-	uint8_t (* handler)(void * nonnull, size_t, uint8_t *) = (__typeof(handler))bus->read_mappings[pagenum].handler;
+	if (LIKELY(addr % MEMBUS_PAGESIZE != MEMBUS_PAGESIZE - 1 &&
+		   bus->read_mappings[pagenum].obj &&
+		   !bus->read_mappings[pagenum].offset_p1)) {
+		uint16_t val;
+		memcpy(&val, bus->read_mappings[pagenum].data + addr % MEMBUS_PAGESIZE, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		val = __builtin_bswap16(val);
+#endif
+		bus->data_lanes = (uint8_t)(val >> 8);
+		return val;
+	}
 
-	uint8_t unmixed_val;
-	uint8_t lane_mask = 0xFF;
+	uint16_t lo = membus_read(bus, addr);
+	uint16_t hi = membus_read(bus, hi_addr);
+	return lo | (uint16_t)(hi << 8);
+}
 
-	if (LIKELY(obj)) {
-		if (UNLIKELY(offset_p1)) {
-			size_t final_addr = (size_t)addr % MEMBUS_PAGESIZE + offset_p1 - 1;
-			unmixed_val = handler(obj, final_addr, &lane_mask);
-		}
-		else {
-			unmixed_val = data[addr % MEMBUS_PAGESIZE];
-		}
-	}
-	else {
-		lane_mask = 0x00;
-		unmixed_val = 0x00;
-	}
+uint16_t
+membus_read16 (membus_t * bus, uint16_t addr)
+{
+	return read16(bus, addr, (uint16_t)(addr + 1));
+}
 
-#ifndef OPEN_BUS_TO_VCC
-	bus->data_lanes &= ~lane_mask;
-	bus->data_lanes |= unmixed_val;
-	return bus->data_lanes;
-#else
-	return unmixed_val | ~lane_mask;
-#endif
+uint16_t
+membus_read16_pagewrap (membus_t * bus, uint16_t addr)
+{
+	return read16(bus, addr, (addr & 0xFF00) | (uint8_t)(addr + 1));
 }
 
 void
@@ -76,9 +143,7 @@ membus_write (membus_t * bus, uint16_t addr, uint8_t val)
 	size_t offset_p1 = bus->write_mappings[pagenum].offset_p1;
 	void (* handler)(void * nonnull, size_t, uint8_t) = (__typeof(handler))bus->write_mappings[pagenum].handler;
 
-#ifndef OPEN_BUS_TO_VCC
 	bus->data_lanes = val;
-#endif
 
 	if (UNLIKELY(!obj)) {
 		return;
@@ -93,6 +158,60 @@ membus_write (membus_t * bus, uint16_t addr, uint8_t val)
 	data[addr % MEMBUS_PAGESIZE] = val;
 }
 
+void
+membus_copy_out (membus_t * bus, uint16_t addr, uint8_t * dest, size_t len)
+{
+	while (len) {
+		size_t pagenum = addr / MEMBUS_PAGESIZE;
+		size_t start = addr % MEMBUS_PAGESIZE;
+		size_t n = MEMBUS_PAGESIZE - start;
+		if (n > len) {
+			n = len;
+		}
+
+		if (LIKELY(bus->read_mappings[pagenum].obj && !bus->read_mappings[pagenum].offset_p1)) {
+			memcpy(dest, bus->read_mappings[pagenum].data + start, n);
+			bus->data_lanes = dest[n - 1];
+		}
+		else {
+			for (size_t i = 0; i < n; i++) {
+				dest[i] = membus_read(bus, (uint16_t)(addr + i));
+			}
+		}
+
+		addr = (uint16_t)(addr + n);
+		dest += n;
+		len -= n;
+	}
+}
+
+void
+membus_copy_in (membus_t * bus, uint16_t addr, const uint8_t * src, size_t len)
+{
+	while (len) {
+		size_t pagenum = addr / MEMBUS_PAGESIZE;
+		size_t start = addr % MEMBUS_PAGESIZE;
+		size_t n = MEMBUS_PAGESIZE - start;
+		if (n > len) {
+			n = len;
+		}
+
+		if (LIKELY(bus->write_mappings[pagenum].obj && !bus->write_mappings[pagenum].offset_p1)) {
+			memcpy(bus->write_mappings[pagenum].data + start, src, n);
+			bus->data_lanes = src[n - 1];
+		}
+		else {
+			for (size_t i = 0; i < n; i++) {
+				membus_write(bus, (uint16_t)(addr + i), src[i]);
+			}
+		}
+
+		addr = (uint16_t)(addr + n);
+		src += n;
+		len -= n;
+	}
+}
+
 void
 membus_clear_page (membus_t * bus, size_t pagenum)
 {
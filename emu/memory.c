@@ -9,18 +9,43 @@ reset (memory_t * memory)
 	memset(memory->bytes, 0xFF, memory->size);
 }
 
+static void
+deinit (memory_t * memory)
+{
+	if (memory->image) {
+		romimage_release((romimage_t * nonnull)memory->image);
+	}
+}
+
 memory_t *
 memory_new (reset_manager_t * rm, size_t size, bool writeable)
 {
-	memory_t * mem = rc_alloc(sizeof(memory_t) + size, NULL);
+	memory_t * mem = rc_alloc(sizeof(memory_t) + size, deinit);
 	mem->size      = size;
 	mem->writeable = writeable;
+	mem->bytes     = (uint8_t *)(mem + 1);
 	if (writeable) {
 		reset_manager_add_device(rm, mem, reset);
 	}
 	return mem;
 }
 
+memory_t *
+memory_new_view (romimage_t * image, const char * path, size_t start, size_t size)
+{
+	if (start > image->size || size > image->size - start) {
+		ERROR_PRINT("Unexpected EOF while reading %s", path);
+		return NULL;
+	}
+
+	memory_t * mem = rc_alloc(sizeof(memory_t), deinit);
+	mem->size      = size;
+	mem->writeable = false;
+	mem->bytes     = (uint8_t *)image->data + start;
+	mem->image     = romimage_retain(image);
+	return mem;
+}
+
 void
 memory_map (memory_t * mem, membus_t * bus, uint16_t bus_start, uint16_t size, size_t start)
 {
@@ -5,8 +5,11 @@ EMU_SRC += main.c \
 	   shell.c \
 	   ines.c \
 	   rc.c \
+	   romimage.c \
+	   arena.c \
 	   timekeeper.c \
 	   memory.c \
 	   membus.c \
 	   reset_manager.c \
+	   hash.c \
 	   fileio.c
@@ -43,8 +43,7 @@ void mos6502_raise_nmi(mos6502_t* cpu) { cpu->intr_status = INTR_NMI; }
 // See https://wiki.nesdev.com/w/index.php/CPU_power_up_state
 // This simulates power-up state, as opposed to reset state
 void mos6502_reset(mos6502_t* cpu) {
-  cpu->pc = membus_read(cpu->bus, 0xfffc) |
-            (uint16_t)(membus_read(cpu->bus, 0xfffd) << 8);
+  cpu->pc = membus_read16(cpu->bus, 0xfffc);
   cpu->a = 0;
   cpu->x = 0;
   cpu->y = 0;
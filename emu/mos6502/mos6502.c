@@ -60,21 +60,13 @@ static inline void write8(mos6502_t* cpu, uint16_t addr, uint8_t val) {
 }
 
 static inline uint16_t read16(mos6502_t* cpu, uint16_t addr) {
-  uint16_t lo = (uint16_t)read8(cpu, addr);
-  uint16_t hi = (uint16_t)read8(cpu, addr + 1);
-  uint16_t val = lo | (uint16_t)(hi << 8);
-  return val;
+  return membus_read16(cpu->bus, addr);
 }
 
-static inline uint16_t buggy_read16(mos6502_t* cpu, uint16_t addr) {
-  uint16_t first = addr;
-  uint16_t secnd = (addr & 0xFF00);  // | (uint16_t)((uint8_t)addr + 1);
-
-  uint16_t lo = (uint16_t)read8(cpu, first);
-  uint16_t hi = (uint16_t)read8(cpu, secnd);
-  uint16_t val = (uint16_t)(hi << 8) | lo;
-
-  return val;
+// reads a 16-bit value without carrying into the next page, as the 6502 does
+// for zero-page pointers, the stack, and the indirect JMP bug
+static inline uint16_t read16_pagewrap(mos6502_t* cpu, uint16_t addr) {
+  return membus_read16_pagewrap(cpu->bus, addr);
 }
 
 static int decode(mos6502_t* cpu, int pc, enc_t* enc) {
@@ -124,40 +116,24 @@ static int decode(mos6502_t* cpu, int pc, enc_t* enc) {
       return pc + 1;
 
     case MODE_IND:
-
-    {
-      uint16_t plo = read8(cpu, pc + 1);
-      uint16_t phi = read8(cpu, pc + 2);
-
-      uint16_t ptr = (phi << 8) | plo;
-
-      enc->arg16 = ptr;
-
-      // oof, a bug
-      if (plo == 0xFF) {
-        // fprintf(stderr, "BUG!\n");
-        enc->abs_addr = buggy_read16(cpu, ptr);
-        // fprintf(stderr, "abs = %04x\n", enc->abs_addr);
-      } else {
-        // fprintf(stderr, "NO BUG!\n");
-        enc->abs_addr = read16(cpu, ptr);
-      }
+      enc->arg16 = read16(cpu, pc + 1);
+      // oof, a bug: a pointer at $xxFF takes its MSB from $xx00
+      enc->abs_addr = read16_pagewrap(cpu, enc->arg16);
       return pc + 3;
-    }
 
     case MODE_XIND:
       // the supplied 8-bit address is offset by X reg to index a location in
       // page 0x00 the actual address is read from this location
       enc->arg8 = read8(cpu, pc + 1);
-      // read the actual address
-      enc->abs_addr = read16(cpu, enc->arg8 + cpu->x);
+      // read the actual address, wrapping around the zero page
+      enc->abs_addr = read16_pagewrap(cpu, (uint8_t)(enc->arg8 + cpu->x));
       return pc + 2;
 
     case MODE_INDY:
       // Indirect-indexed
       enc->arg8 = read8(cpu, pc + 1);
-      // read the actual address
-      enc->abs_addr = read16(cpu, enc->arg8) + cpu->y;
+      // read the actual address, wrapping around the zero page
+      enc->abs_addr = read16_pagewrap(cpu, enc->arg8) + cpu->y;
       return pc + 2;
 
     case MODE_REL:
@@ -196,7 +172,7 @@ size_t mos6502_instr_repr(mos6502_t* cpu, uint16_t addr, char* buffer,
                           size_t buflen) {
   buffer[0] = 0;
 
-  enc_t e;
+  enc_t e = {0};
   decode(cpu, addr, &e);
 
   if (!e.valid) return 0;
@@ -263,6 +239,13 @@ static uint8_t stk_pop(mos6502_t* cpu) {
   return read8(cpu, 0x0100 + (++cpu->sp));
 }
 
+// pops a little-endian address, wrapping around the stack page
+static uint16_t stk_pop16(mos6502_t* cpu) {
+  uint16_t val = read16_pagewrap(cpu, 0x0100 + (uint8_t)(cpu->sp + 1));
+  cpu->sp += 2;
+  return val;
+}
+
 static int handle_irq(mos6502_t* cpu) {
   cpu->intr_status &= ~INTR_IRQ;
 
@@ -706,14 +689,12 @@ defop(RTI) {
   cpu->p.b = 0;
   cpu->p.u = 1;
 
-  cpu->pc = stk_pop(cpu) & 0xFF;
-  cpu->pc |= ((uint16_t)stk_pop(cpu) << 8);
+  cpu->pc = stk_pop16(cpu);
 }
 
 
 defop(RTS) {
-  cpu->pc = stk_pop(cpu);
-  cpu->pc |= stk_pop(cpu) << 8;
+  cpu->pc = stk_pop16(cpu);
   cpu->pc++;
 }
 
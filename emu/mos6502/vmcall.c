@@ -25,8 +25,7 @@ set_ax (mos6502_t * cpu, uint16_t val)
 static inline uint16_t
 read_zp16 (mos6502_t * cpu, uint8_t addr)
 {
-
-	return membus_read(cpu->bus, addr) | (uint16_t)(membus_read(cpu->bus, addr + 1) << 8);
+	return membus_read16(cpu->bus, addr);
 }
 
 static inline void
@@ -42,7 +41,7 @@ pop_parm (mos6502_t * cpu, uint16_t incr)
 {
 
 	uint16_t sp = read_zp16(cpu, 0x00);
-	uint16_t val = membus_read(cpu->bus, sp) | (uint16_t)(membus_read(cpu->bus, sp + 1) << 8u);
+	uint16_t val = membus_read16(cpu->bus, sp);
 	write16(cpu, 0x0000, sp + incr);
 	return val;
 }
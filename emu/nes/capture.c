@@ -0,0 +1,283 @@
+#include <rc.h>
+#include <base.h>
+#include <fileio.h>
+#include <nes/capture.h>
+
+#include <errno.h>
+#include <string.h>
+
+#define NPIXELS (PPU_OUTPUT_HEIGHT * PPU_OUTPUT_WIDTH)
+
+// Writes `nbytes` bytes to the capture's file, returning whether they were
+static bool
+write_bytes (capture_t * nonnull capture, const void * nonnull data, size_t nbytes)
+{
+	if (fwrite(data, nbytes, 1, capture->f) != 1) {
+		ERROR_PRINT("Error writing %s: %s", capture->path, strerror(errno));
+		return false;
+	}
+	atomic_fetch_add_explicit(&capture->nbytes, nbytes, memory_order_relaxed);
+	return true;
+}
+
+static inline void
+put_le16 (uint8_t * nonnull p, uint16_t val)
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)(val >> 8);
+}
+
+static inline void
+put_le32 (uint8_t * nonnull p, uint32_t val)
+{
+	put_le16(p, (uint16_t)val);
+	put_le16(p + 2, (uint16_t)(val >> 16));
+}
+
+// Returns whether pixel `i` of a frame (counting across each line in turn) is
+// in one of the tiles marked in `dirty`
+static inline bool
+in_dirty_tile (const video_dirty_t * nonnull dirty, size_t i)
+{
+	size_t y = i / PPU_OUTPUT_WIDTH, x = i % PPU_OUTPUT_WIDTH;
+	return (dirty->rows[y / VIDEO_TILE_SIZE] >> (x / VIDEO_TILE_SIZE)) & 1;
+}
+
+// Returns whether pixel `i` is the same as in the last frame written, which
+// needn't be checked outside the dirty tiles
+static inline bool
+unchanged (const capture_t * nonnull capture, const capture_slot_t * nonnull slot, size_t i)
+{
+	return !in_dirty_tile(&slot->dirty, i) || (&slot->frame[0][0])[i] == (&capture->prev[0][0])[i];
+}
+
+// Encodes the frame in `slot` into `capture->runs`, relative to the last frame
+// written, and returns the number of entries used. Each run either repeats the
+// previous frame for as long as it matches, or repeats one palette index for as
+// long as it lasts.
+static size_t
+encode_frame (capture_t * nonnull capture, const capture_slot_t * nonnull slot)
+{
+	const uint16_t * pixels = &slot->frame[0][0];
+	uint16_t * runs = capture->runs;
+	size_t nruns = 0;
+
+	for (size_t i = 0; i < NPIXELS;) {
+		size_t j = i + 1;
+		uint16_t val;
+		if (unchanged(capture, slot, i)) {
+			// Skip over whole clean tiles at a time
+			while (j < NPIXELS) {
+				if (!in_dirty_tile(&slot->dirty, j) && j % VIDEO_TILE_SIZE == 0) {
+					j += VIDEO_TILE_SIZE;
+				}
+				else if (unchanged(capture, slot, j)) {
+					j++;
+				}
+				else {
+					break;
+				}
+			}
+			val = CAPTURE_RUN_UNCHANGED;
+		}
+		else {
+			while (j < NPIXELS && pixels[j] == pixels[i]) {
+				j++;
+			}
+			val = pixels[i];
+		}
+
+		// A frame has fewer pixels than a run length can count
+		runs[2 * nruns] = (uint16_t)(j - i);
+		runs[2 * nruns + 1] = val;
+		nruns++;
+		i = j;
+	}
+
+	return nruns;
+}
+
+static bool
+write_frame (capture_t * nonnull capture, const capture_slot_t * nonnull slot)
+{
+	size_t nruns = encode_frame(capture, slot);
+
+	// Only the dirty tiles can differ from the last frame
+	for (size_t y = 0; y < PPU_OUTPUT_HEIGHT; y++) {
+		for (uint32_t row = slot->dirty.rows[y / VIDEO_TILE_SIZE]; row; row &= row - 1) {
+			size_t x = (size_t)__builtin_ctz(row) * VIDEO_TILE_SIZE;
+			memcpy(&capture->prev[y][x], &slot->frame[y][x], VIDEO_TILE_SIZE * sizeof(uint16_t));
+		}
+	}
+
+	// The runs are already in the host's byte order, which is
+	// little-endian everywhere we build
+	size_t nbytes = nruns * 2 * sizeof(uint16_t);
+	uint8_t header[8];
+	put_le32(header, (uint32_t)slot->framenum);
+	put_le32(header + 4, (uint32_t)nbytes);
+	return write_bytes(capture, header, sizeof(header)) && write_bytes(capture, capture->runs, nbytes);
+}
+
+static void * nullable
+run (void * nonnull arg)
+{
+	capture_t * capture = arg;
+
+	while (true) {
+		pthread_mutex_lock(&capture->lock);
+		while (atomic_load_explicit(&capture->head, memory_order_acquire) == capture->tail &&
+		       !atomic_load_explicit(&capture->stopping, memory_order_relaxed)) {
+			pthread_cond_wait(&capture->nonempty, &capture->lock);
+		}
+		pthread_mutex_unlock(&capture->lock);
+
+		// Frames submitted before stopping are still written, so check
+		// for it before draining the queue
+		bool stopping = atomic_load_explicit(&capture->stopping, memory_order_acquire);
+
+		size_t head = atomic_load_explicit(&capture->head, memory_order_acquire);
+		size_t tail = atomic_load_explicit(&capture->tail, memory_order_relaxed);
+		for (; tail != head; tail++) {
+			// After an error, frames are still taken off the queue
+			// (so that the emulation thread can carry on), but are
+			// discarded
+			if (!atomic_load_explicit(&capture->failed, memory_order_relaxed)) {
+				if (write_frame(capture, &capture->slots[tail % CAPTURE_QUEUE_LEN])) {
+					atomic_fetch_add_explicit(&capture->nwritten, 1, memory_order_relaxed);
+				}
+				else {
+					atomic_store(&capture->failed, true);
+				}
+			}
+			atomic_store_explicit(&capture->tail, tail + 1, memory_order_release);
+		}
+
+		if (stopping) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+deinit (capture_t * nonnull capture)
+{
+	capture_stop(capture);
+	fclose(capture->f);
+	pthread_cond_destroy(&capture->nonempty);
+	pthread_mutex_destroy(&capture->lock);
+}
+
+capture_t *
+capture_new (const char * path, const video_palette_t * palette)
+{
+	FILE * f = try_fopen(path, "wb");
+	if (!f) {
+		return NULL;
+	}
+
+	capture_t * capture = rc_alloc(sizeof(capture_t), deinit);
+	capture->f = f;
+	capture->path = path;
+	pthread_mutex_init(&capture->lock, NULL);
+	pthread_cond_init(&capture->nonempty, NULL);
+
+	// The first frame is relative to a framebuffer that has never been
+	// drawn to
+	for (size_t y = 0; y < PPU_OUTPUT_HEIGHT; y++) {
+		for (size_t x = 0; x < PPU_OUTPUT_WIDTH; x++) {
+			capture->prev[y][x] = PPU_PIXEL_BLANK;
+		}
+	}
+
+	uint8_t header[9];
+	memcpy(header, "HKVC", 4);
+	header[4] = CAPTURE_VERSION;
+	put_le16(header + 5, PPU_OUTPUT_WIDTH);
+	put_le16(header + 7, PPU_OUTPUT_HEIGHT);
+	if (!write_bytes(capture, header, sizeof(header)) ||
+	    !write_bytes(capture, palette->srgb, sizeof(palette->srgb))) {
+		goto error;
+	}
+
+	if (pthread_create(&capture->thread, NULL, run, capture)) {
+		ERROR_PRINT("Could not start the capture thread");
+		goto error;
+	}
+	capture->running = true;
+
+	return capture;
+error:
+	rc_release(capture);
+	return NULL;
+}
+
+void
+capture_submit (capture_t * capture,
+		size_t framenum,
+		const uint16_t (* frame)[PPU_OUTPUT_WIDTH],
+		const video_dirty_t * dirty)
+{
+	atomic_fetch_add_explicit(&capture->nsubmitted, 1, memory_order_relaxed);
+
+	for (size_t i = 0; i < VIDEO_TILE_ROWS; i++) {
+		capture->pending_dirty.rows[i] |= dirty->rows[i];
+	}
+
+	size_t head = atomic_load_explicit(&capture->head, memory_order_relaxed);
+	size_t depth = head - atomic_load_explicit(&capture->tail, memory_order_acquire);
+	if (depth == CAPTURE_QUEUE_LEN) {
+		atomic_fetch_add_explicit(&capture->ndropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	capture_slot_t * slot = &capture->slots[head % CAPTURE_QUEUE_LEN];
+	slot->framenum = framenum;
+	slot->dirty = capture->pending_dirty;
+	memset(&capture->pending_dirty, 0, sizeof(capture->pending_dirty));
+	memcpy(slot->frame, frame, sizeof(slot->frame));
+	atomic_store_explicit(&capture->head, head + 1, memory_order_release);
+
+	if (depth + 1 > atomic_load_explicit(&capture->max_depth, memory_order_relaxed)) {
+		atomic_store_explicit(&capture->max_depth, depth + 1, memory_order_relaxed);
+	}
+
+	pthread_mutex_lock(&capture->lock);
+	pthread_cond_signal(&capture->nonempty);
+	pthread_mutex_unlock(&capture->lock);
+}
+
+void
+capture_stop (capture_t * capture)
+{
+	if (!capture->running) {
+		return;
+	}
+
+	pthread_mutex_lock(&capture->lock);
+	atomic_store(&capture->stopping, true);
+	pthread_cond_signal(&capture->nonempty);
+	pthread_mutex_unlock(&capture->lock);
+
+	pthread_join(capture->thread, NULL);
+	capture->running = false;
+
+	if (fflush(capture->f)) {
+		ERROR_PRINT("Error writing %s: %s", capture->path, strerror(errno));
+	}
+}
+
+void
+capture_print_stats (capture_t * capture)
+{
+	INFO_PRINT("Captured %zu of %zu frames to %s (%zu dropped, queue peaked at %zu of %d, %.1f MiB)",
+		   atomic_load(&capture->nwritten),
+		   atomic_load(&capture->nsubmitted),
+		   capture->path,
+		   atomic_load(&capture->ndropped),
+		   atomic_load(&capture->max_depth),
+		   CAPTURE_QUEUE_LEN,
+		   (double)atomic_load(&capture->nbytes) / (1024 * 1024));
+}
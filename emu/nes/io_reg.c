@@ -3,6 +3,7 @@
 #include <nes/io_reg.h>
 
 #include <errno.h>
+#include <string.h>
 
 static inline void
 set_strobe (io_reg_t * io, bool val)
@@ -13,11 +14,9 @@ set_strobe (io_reg_t * io, bool val)
 		// Sync up with real time.
 		timekeeper_sync(io->cpu->tk);
 
-		// Make sure SDL updates the keyboard state array before we
-		// read from it.
-		SDL_PumpEvents();
-
-		// Update the shift registers according to the current key-press state.
+		// Update the shift registers according to the current key-press
+		// state, which SDL keeps up to date as the presentation thread
+		// pumps events.
 		const uint8_t * kbstate = SDL_GetKeyboardState(NULL);
 		for (size_t j = 0; j < 2; j++) {
 			for (size_t i = 0; i < CONTROLLER_NBUTTONS; i++) {
@@ -42,7 +41,6 @@ read (io_reg_t * io, uint16_t addr, uint8_t * lanemask)
 		// A-button state.
 		if (io->controller_strobe) {
 			timekeeper_sync(io->cpu->tk);
-			SDL_PumpEvents();
 			const uint8_t * kbstate = SDL_GetKeyboardState(NULL);
 			bit = kbstate[io->controller_mappings[addr - 0x16][CONTROLLER_BUTTON_A]];
 		}
@@ -67,34 +65,25 @@ write (io_reg_t * io, uint16_t addr, uint8_t val)
 		set_strobe(io, val & 0x01);
 		return;
 	case 0x14: { // OAMDMA
-		uint16_t readaddr = (uint16_t)(val << 8);
-
-		// dummy read cycle
-		mos6502_advance_clk(io->cpu, 1);
-
-#if defined(REFERENCE) && !defined(DISABLE_CYCLECHECK)
-		io->cpu->last_takeover_delay++;
-#endif
-
-		if ((io->cpu->tk->clk_cyclenum / MOS6502_CLKDIVISOR) % 2) {
-			// Dummy read cycle (TODO of what?) if on an odd CPU cycle
-			mos6502_advance_clk(io->cpu, 1);
-
-#if defined(REFERENCE) && !defined(DISABLE_CYCLECHECK)
-			io->cpu->last_takeover_delay++;
-#endif
+		// The CPU is halted for one dummy read cycle, one more if the
+		// transfer starts on an odd CPU cycle, and then a read and a
+		// write cycle for each of the 256 bytes copied
+		size_t ncycles = 1 + 256 * 2;
+		if ((io->cpu->tk->clk_cyclenum / MOS6502_CLKDIVISOR + 1) % 2) {
+			ncycles++;
 		}
 
-		for (uint16_t i = 0; i < 256; i++) {
-			uint8_t byte = membus_read(io->cpu->bus, readaddr + i);
-			mos6502_advance_clk(io->cpu, 1);
-			membus_write(io->cpu->bus, 0x2004, byte);
-			mos6502_advance_clk(io->cpu, 1);
+		// Nothing else can touch the bus during the transfer, so the
+		// whole page is read in one go, handed to OAM in one go, and
+		// the clock is advanced over the entire takeover at once
+		uint8_t page[256];
+		membus_copy_out(io->cpu->bus, (uint16_t)(val << 8), page, sizeof(page));
+		ppu_oam_dma(io->ppu, page);
+		mos6502_advance_clk(io->cpu, ncycles);
 
 #if defined(REFERENCE) && !defined(DISABLE_CYCLECHECK)
-			io->cpu->last_takeover_delay += 2;
+		io->cpu->last_takeover_delay += ncycles;
 #endif
-		}
 
 		return;
 	}
@@ -103,6 +92,12 @@ write (io_reg_t * io, uint16_t addr, uint8_t val)
 	}
 }
 
+static void
+deinit (io_reg_t * io)
+{
+	rc_release(io->ppu);
+}
+
 static void
 reset (io_reg_t * io)
 {
@@ -111,13 +106,14 @@ reset (io_reg_t * io)
 }
 
 io_reg_t *
-io_reg_new (reset_manager_t * rm, mos6502_t * cpu, const char * cscheme_path)
+io_reg_new (reset_manager_t * rm, mos6502_t * cpu, ppu_t * ppu, const char * cscheme_path)
 {
 	io_reg_t * retval = NULL;
 
-	io_reg_t * io = rc_alloc(sizeof(io_reg_t), NULL);
+	io_reg_t * io = rc_alloc(sizeof(io_reg_t), deinit);
 	reset_manager_add_device(rm, io, reset);
 	io->cpu = cpu;
+	io->ppu = rc_retain(ppu);
 
 	FILE * f = try_fopen(cscheme_path, "r");
 	if (!f) {
@@ -156,11 +152,11 @@ release_io:
 }
 
 int
-io_reg_setup (reset_manager_t * rm, mos6502_t * cpu, const char * cscheme_path)
+io_reg_setup (reset_manager_t * rm, mos6502_t * cpu, ppu_t * ppu, const char * cscheme_path)
 {
 	int retcode = -1;
 
-	io_reg_t * io = io_reg_new(rm, cpu, cscheme_path);
+	io_reg_t * io = io_reg_new(rm, cpu, ppu, cscheme_path);
 	if (!io) {
 		ERROR_PRINT("Couldn't create an IO register device");
 		goto ret;
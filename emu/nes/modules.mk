@@ -2,4 +2,9 @@ EMU_SRC += nes/io_reg.c \
 	   nes/nrom.c \
 	   nes/sxrom.c \
 	   nes/mmc1.c \
-	   nes/ppu.c
+	   nes/ppu.c \
+	   nes/presenter.c \
+	   nes/ntsc.c \
+	   nes/video.c \
+	   nes/capture.c \
+	   nes/ppu_trace.c
@@ -87,6 +87,7 @@ nrom_setup (rominfo_t * info)
 			   info->vram->size/2);
 		break;
 	}
+	ppu_remap(info->ppu);
 
 	return 0;
 }
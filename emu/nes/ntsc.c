@@ -0,0 +1,269 @@
+#include <rc.h>
+#include <base.h>
+#include <nes/ntsc.h>
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+// See [https://wiki.nesdev.com/w/index.php/NTSC_video] for the signal this
+// models
+
+// Samples per PPU pixel, and per cycle of the color subcarrier
+#define SAMPLES_PER_PIXEL 8
+#define SAMPLES_PER_CYCLE 12
+
+// Each line is 341 pixels long, which shifts the subcarrier's phase by 4
+// samples from one line to the next. With rendering enabled, odd frames are a
+// pixel shorter, so frames alternate between starting at two phases.
+#define LINE_PHASE_SHIFT 4
+#define FRAME_PHASE_SHIFT 4
+
+// The signal's voltage levels, relative to sync, for each of a color's 4
+// brightnesses, when the square wave is low and high
+static const double levels[2][4] = {
+	{0.350, 0.518, 0.962, 1.550},
+	{1.094, 1.506, 1.962, 1.962},
+};
+#define LEVEL_BLACK 0.518
+#define LEVEL_WHITE 1.962
+#define EMPH_ATTENUATION 0.746
+
+// Where the decoder's reference phase sits relative to the signal's, which
+// puts hues where the standard palette has them
+#define HUE_SHIFT 4
+
+// Returns whether a square wave of `hue` is high at `phase`
+static inline bool
+in_color_phase (unsigned hue, unsigned phase)
+{
+	return (hue + phase) % SAMPLES_PER_CYCLE < SAMPLES_PER_CYCLE / 2;
+}
+
+// Returns the PPU's output for the 9-bit pixel `pixel` at `phase`, from 0 for
+// black to 1 for white
+static double
+signal (uint16_t pixel, unsigned phase)
+{
+	unsigned hue = pixel & 0x0F;
+	unsigned brightness = (pixel >> 4) & 0x03;
+	unsigned emph = pixel >> 6;
+
+	// Hues $D-$F are black, or darker
+	if (hue > 13) {
+		brightness = 1;
+	}
+	double low = levels[0][brightness], high = levels[1][brightness];
+	if (hue == 0) {
+		low = high;
+	}
+	if (hue > 12) {
+		high = low;
+	}
+
+	double level = in_color_phase(hue, phase) ? high : low;
+	if (((emph & 1) && in_color_phase(0, phase)) ||
+	    ((emph & 2) && in_color_phase(4, phase)) ||
+	    ((emph & 4) && in_color_phase(8, phase))) {
+		level *= EMPH_ATTENUATION;
+	}
+
+	return (level - LEVEL_BLACK) / (LEVEL_WHITE - LEVEL_BLACK);
+}
+
+// Decodes what `pixel` contributes to the output pixel at sample `center`
+// (relative to the start of the PPU pixel under it, which is at phase
+// `phase`), if `pixel` is `tap - 1` pixels away, into fixed-point RGBA
+static void
+build_kernel (int32_t * nonnull rgba, uint16_t pixel, unsigned phase, int center, int tap)
+{
+	double y = 0, i = 0, q = 0;
+
+	int start = (tap - 1) * SAMPLES_PER_PIXEL;
+	for (int sample = start; sample < start + SAMPLES_PER_PIXEL; sample++) {
+		if (sample < center - SAMPLES_PER_CYCLE / 2 || sample >= center + SAMPLES_PER_CYCLE / 2) {
+			continue;
+		}
+
+		unsigned sample_phase = (unsigned)((int)phase + sample + SAMPLES_PER_CYCLE) % SAMPLES_PER_CYCLE;
+		double level = signal(pixel, sample_phase) / SAMPLES_PER_CYCLE;
+		double angle = M_PI * (sample_phase + HUE_SHIFT) / (SAMPLES_PER_CYCLE / 2);
+		y += level;
+		i += level * cos(angle);
+		q += level * sin(angle);
+	}
+
+	// The FCC's YIQ to RGB conversion
+	double rgb[3] = {
+		y + 0.946882 * i + 0.623557 * q,
+		y - 0.274788 * i - 0.635691 * q,
+		y - 1.108545 * i + 1.709007 * q,
+	};
+	for (size_t c = 0; c < 3; c++) {
+		rgba[c] = (int32_t)lround(rgb[c] * 255 * 256);
+
+		// Round the sum of every tap to the nearest, rather than down
+		if (tap == 1) {
+			rgba[c] += 128;
+		}
+	}
+	rgba[3] = 0;
+}
+
+ntsc_t *
+ntsc_new (int scale)
+{
+	ASSERT(scale >= 1 && scale <= NTSC_MAX_SCALE);
+
+	ntsc_t * ntsc = rc_alloc(sizeof(ntsc_t), NULL);
+	ntsc->scale = scale;
+
+	for (int sub = 0; sub < scale; sub++) {
+		// Output pixels sit in the middle of the part of the PPU pixel
+		// they cover
+		int center = (SAMPLES_PER_PIXEL * sub + SAMPLES_PER_PIXEL / 2) / scale;
+		for (unsigned phase = 0; phase < 3; phase++) {
+			for (int tap = 0; tap < NTSC_TAPS; tap++) {
+				for (uint16_t pixel = 0; pixel <= PPU_PIXEL_BLANK; pixel++) {
+					build_kernel(ntsc->kernels[sub][phase][tap][pixel],
+						     pixel == PPU_PIXEL_BLANK ? 0x0F : pixel,
+						     4 * phase,
+						     center,
+						     tap);
+				}
+			}
+		}
+	}
+
+	return ntsc;
+}
+
+// Returns the phase (in units of 4 samples) that pixel `x` of a line starts at,
+// if the line starts at `line_phase`
+static inline unsigned
+pixel_phase (unsigned line_phase, size_t x)
+{
+	return (line_phase + SAMPLES_PER_PIXEL * x) % SAMPLES_PER_CYCLE / 4;
+}
+
+// Filters one line, which starts at `line_phase` and is padded with a black
+// pixel on either side, into `row`. `scale` is always a constant, so that the
+// divisions by it compile down to shifts.
+static inline void
+filter_line (const ntsc_t * nonnull ntsc,
+	     unsigned line_phase,
+	     const uint16_t * nonnull line,
+	     uint8_t * nonnull row,
+	     size_t scale)
+{
+	// The line is a whole number of vectors wide, so there's never a
+	// scalar tail to take care of
+
+#if defined(__SSE2__)
+	for (size_t o = 0; o < PPU_OUTPUT_WIDTH * scale; o += 4) {
+		__m128i accs[4];
+		for (size_t j = 0; j < 4; j++) {
+			size_t x = (o + j) / scale;
+			const int32_t (* taps)[PPU_PIXEL_BLANK + 1][4] = ntsc->kernels[(o + j) % scale][pixel_phase(line_phase, x)];
+
+			__m128i acc = _mm_loadu_si128((const __m128i *)taps[0][line[x]]);
+			acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i *)taps[1][line[x + 1]]));
+			acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i *)taps[2][line[x + 2]]));
+			accs[j] = _mm_srai_epi32(acc, 8);
+		}
+
+		// Saturate each channel to 0-255 on the way down to bytes
+		__m128i lo = _mm_packs_epi32(accs[0], accs[1]);
+		__m128i hi = _mm_packs_epi32(accs[2], accs[3]);
+		__m128i rgba = _mm_or_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32((int)0xFF000000));
+		_mm_storeu_si128((__m128i *)&row[o * 4], rgba);
+	}
+#else
+	for (size_t o = 0; o < PPU_OUTPUT_WIDTH * scale; o++) {
+		size_t x = o / scale;
+		const int32_t (* taps)[PPU_PIXEL_BLANK + 1][4] = ntsc->kernels[o % scale][pixel_phase(line_phase, x)];
+
+		for (size_t c = 0; c < 3; c++) {
+			int32_t acc = (taps[0][line[x]][c] + taps[1][line[x + 1]][c] + taps[2][line[x + 2]][c]) >> 8;
+			row[o * 4 + c] = (uint8_t)(acc < 0 ? 0 : acc > 255 ? 255 : acc);
+		}
+		row[o * 4 + 3] = 255;
+	}
+#endif
+}
+
+void
+ntsc_filter (const ntsc_t * ntsc,
+	     size_t framenum,
+	     const uint16_t (* frame)[PPU_OUTPUT_WIDTH],
+	     uint8_t * texels,
+	     size_t pitch)
+{
+	for (size_t y = 0; y < PPU_OUTPUT_HEIGHT; y++) {
+		unsigned line_phase = (FRAME_PHASE_SHIFT * (framenum & 1) + LINE_PHASE_SHIFT * y) % SAMPLES_PER_CYCLE;
+
+		uint16_t line[PPU_OUTPUT_WIDTH + 2];
+		line[0] = PPU_PIXEL_BLANK;
+		memcpy(&line[1], frame[y], sizeof(frame[y]));
+		line[PPU_OUTPUT_WIDTH + 1] = PPU_PIXEL_BLANK;
+
+		if (ntsc->scale == 1) {
+			filter_line(ntsc, line_phase, line, texels + y * pitch, 1);
+		}
+		else {
+			filter_line(ntsc, line_phase, line, texels + y * pitch, 2);
+		}
+	}
+}
+
+static double
+now (void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void
+ntsc_benchmark (void)
+{
+	// Random pixels (of every color and emphasis), so that kernel lookups
+	// are spread as widely as they can be
+	static uint16_t frame[PPU_OUTPUT_HEIGHT][PPU_OUTPUT_WIDTH];
+	uint32_t seed = 1;
+	for (size_t y = 0; y < PPU_OUTPUT_HEIGHT; y++) {
+		for (size_t x = 0; x < PPU_OUTPUT_WIDTH; x++) {
+			seed = seed * 1103515245 + 12345;
+			frame[y][x] = (uint16_t)((seed >> 16) % PPU_PIXEL_BLANK);
+		}
+	}
+
+	static uint8_t texels[PPU_OUTPUT_HEIGHT][PPU_OUTPUT_WIDTH * NTSC_MAX_SCALE][4];
+
+	for (int scale = 1; scale <= NTSC_MAX_SCALE; scale++) {
+		ntsc_t * ntsc = ntsc_new(scale);
+
+		// Warm up, then filter for about a second
+		ntsc_filter(ntsc, 0, frame, &texels[0][0][0], sizeof(texels[0]));
+		size_t nframes = 0;
+		double start = now(), elapsed;
+		do {
+			ntsc_filter(ntsc, nframes, frame, &texels[0][0][0], sizeof(texels[0]));
+			nframes++;
+			elapsed = now() - start;
+		} while (elapsed < 1.0);
+
+		INFO_PRINT("NTSC filter at %dx (%dx%d): %.0f frames/s (%.3f ms per frame)",
+			   scale,
+			   PPU_OUTPUT_WIDTH * scale,
+			   PPU_OUTPUT_HEIGHT,
+			   (double)nframes / elapsed,
+			   1000 * elapsed / (double)nframes);
+
+		rc_release(ntsc);
+	}
+}
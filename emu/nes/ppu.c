@@ -34,9 +34,10 @@
  *   expected to become an issue.
  *
  * - The actual hardware directly produced composite NTSC video, which led to
- *   some interesting visual artifacts. Emulating composite video generation
- *   and decoding sounded complicated, so we instead produce very boring
- *   pixelated images.
+ *   some interesting visual artifacts. The PPU itself only produces very
+ *   boring pixelated images; the composite signal and its decoding are
+ *   emulated afterwards (if at all) by a filter on the presentation thread
+ *   (see `nes/ntsc.h`).
  *
  * - There are likely yet-undiscovered issues with this implementation.
  *
@@ -48,40 +49,199 @@
 
 #include <rc.h>
 #include <base.h>
+#include <hash.h>
 #include <membus.h>
+#include <fileio.h>
 #include <nes/ppu.h>
-#include <SDL2/SDL.h>
+#include <nes/capture.h>
 #include <mos6502/mos6502.h>
 
-// Displays the current frame of video to the screen, and processes SDL_QUIT
-// events
+#include <string.h>
+#include <inttypes.h>
+#include <stdnoreturn.h>
+#include <sys/sysinfo.h>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#elif defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+// Returns whether the current frame is one that's left undrawn, either by
+// frame-skip or because nothing would see it anyway. This is cached in
+// `ppu->frame_skipped` at the start of each frame.
+static inline bool
+frame_skipped (ppu_t * nonnull ppu)
+{
+	return (!ppu->video.write_frame && !ppu->frame_hashes && !ppu->capture) ||
+	       ppu->framenum % ppu->frameskip != 0;
+}
+
+// Finishes up all of the PPU's output, and exits
+static noreturn void
+quit (ppu_t * nonnull ppu)
+{
+	ppu_finish(ppu);
+	INFO_PRINT("Goodbye!");
+	exit(EXIT_SUCCESS);
+}
+
+// Quits, or if the PPU has a thread of its own (which this must be called
+// from), has the CPU thread quit the next time it waits for the PPU. The PPU
+// thread never gets any further than that anyway.
+static inline void
+request_quit (ppu_t * nonnull ppu)
+{
+	if (ppu->worker) {
+		ppu->worker->quit_pending = true;
+	}
+	else {
+		quit(ppu);
+	}
+}
+
+// Records an event on dot `dotnum` of the current scanline, which is on
+// `cyclenum`, if the PPU is being traced
+static inline void
+trace_at (ppu_t * nonnull ppu, ppu_trace_event_t event, uint64_t cyclenum, size_t dotnum, uint8_t regnum, uint16_t val)
+{
+	if (LIKELY(!ppu->trace)) {
+		return;
+	}
+
+	ppu_trace_record((ppu_trace_t * nonnull)ppu->trace, (ppu_trace_record_t){
+		.cyclenum = cyclenum,
+		.slnum    = (uint16_t)ppu->slnum,
+		.dotnum   = (uint16_t)dotnum,
+		.val      = val,
+		.event    = (uint8_t)event,
+		.regnum   = regnum,
+	});
+}
+
+// Records an event on the dot under the cursor, if the PPU is being traced
+static inline void
+trace (ppu_t * nonnull ppu, ppu_trace_event_t event, uint8_t regnum, uint16_t val)
+{
+	trace_at(ppu, event, ppu->synced_cyclenum, ppu->dotnum, regnum, val);
+}
+
+// Records an event on dot `dotnum` of a scanline being rendered all at once
+// (whose first dot is still the one the PPU is synced to), if the PPU is
+// being traced
+static inline void
+trace_in_line (ppu_t * nonnull ppu, ppu_trace_event_t event, size_t dotnum)
+{
+	trace_at(ppu, event, ppu->synced_cyclenum + dotnum * PPU_CLKDIVISOR, dotnum, 0, 0);
+}
+
+// Tells the mapper watching the PPU's address bus (if any) that the PPU put
+// `addr` on it on `cyclenum`
+static inline void
+watch_at (ppu_t * nonnull ppu, uint16_t addr, uint64_t cyclenum)
+{
+	ppu_watcher_t * watcher = &ppu->watcher;
+	if (LIKELY(!watcher->obj)) {
+		return;
+	}
+
+	if (watcher->fetch) {
+		watcher->fetch((void * nonnull)watcher->obj, addr, cyclenum);
+		return;
+	}
+
+	bool high = addr & 0x1000;
+	if (high && !watcher->a12_high &&
+	    cyclenum - watcher->a12_fell_cyclenum >= PPU_A12_FILTER_DOTS * PPU_CLKDIVISOR) {
+		watcher->a12_rise((void * nonnull)watcher->obj, cyclenum);
+	}
+	if (!high && watcher->a12_high) {
+		watcher->a12_fell_cyclenum = cyclenum;
+	}
+	watcher->a12_high = high;
+}
+
+// Tells the mapper watching the PPU's address bus (if any) that the PPU put
+// `addr` on it on the dot under the cursor
+static inline void
+watch (ppu_t * nonnull ppu, uint16_t addr)
+{
+	watch_at(ppu, addr, ppu->synced_cyclenum);
+}
+
+// Raises NMI, or if the PPU has a thread of its own, has the CPU thread raise
+// it the next time it waits for the PPU (which it does on any cycle that NMI
+// could be raised on)
+static inline void
+raise_nmi (ppu_t * nonnull ppu)
+{
+	trace(ppu, PPU_TRACE_NMI, 0, 0);
+
+	if (ppu->worker) {
+		ppu->worker->nmi_pending = true;
+	}
+	else {
+		mos6502_raise_nmi(ppu->cpu);
+	}
+}
+
+// Sends the current frame to the video sink, and records it and its hash
+// (unless it's being skipped), and exits if the user has asked to quit or the
+// last frame has been reached
 static inline void
 present_frame (ppu_t * nonnull ppu)
 {
-	// Check if we should quit (e.g. the user clicked the close-window button)
-	SDL_Event event;
-	while (SDL_PollEvent(&event)) {
-		if (event.type == SDL_QUIT) {
-			INFO_PRINT("Goodbye!");
-			exit(EXIT_SUCCESS);
+	if (ppu->video.quit_requested && ppu->video.quit_requested((void * nonnull)ppu->video.obj)) {
+		request_quit(ppu);
+		return;
+	}
+
+	if (!ppu->frame_skipped) {
+		ppu->presented_dirty = ppu->dirty;
+		memset(&ppu->dirty, 0, sizeof(ppu->dirty));
+
+		if (ppu->video.write_frame) {
+			ppu->video.write_frame((void * nonnull)ppu->video.obj, ppu->framenum, ppu->framebuf, &ppu->presented_dirty);
 		}
+		if (ppu->frame_hashes) {
+			fprintf((FILE * nonnull)ppu->frame_hashes, "%zu %016" PRIx64 "\n", ppu->framenum, ppu_frame_hash(ppu));
+		}
+		if (ppu->capture) {
+			capture_submit((capture_t * nonnull)ppu->capture, ppu->framenum, ppu->framebuf, &ppu->presented_dirty);
+		}
+	}
+
+	if (ppu->nframes && ppu->framenum >= ppu->nframes) {
+		request_quit(ppu);
 	}
+}
 
-	// "Commit" the new frame contents to the backing `SDL_Texture` object
-	SDL_UnlockTexture(ppu->tex);
+// Returns whether the background or sprites (or both) are being rendered
+static inline bool
+rendering_en (ppu_t * nonnull ppu)
+{
+	return ppu->mask & PPU_MASK_RENDERING_EN;
+}
 
-	// Copy the frame to the backbuffer, upscaling it if required
-	SDL_RenderCopy(ppu->rend, ppu->tex, NULL, NULL);
+// Returns the coarse (8-pixel) x-scroll in the VRAM address
+static inline uint8_t
+coarse_xscroll (ppu_t * nonnull ppu)
+{
+	return ppu->vram_addr & PPU_VRAM_COARSE_X;
+}
 
-	// Swap buffers to display the new frame, synchronously blocking until
-	// a new backbuffer is available
-	SDL_RenderPresent(ppu->rend);
+// Returns the coarse (8-pixel) y-scroll in the VRAM address
+static inline uint8_t
+coarse_yscroll (ppu_t * nonnull ppu)
+{
+	return (ppu->vram_addr & PPU_VRAM_COARSE_Y) >> 5;
+}
 
-	// Lock the frame texture so that it can be overwritten with the next
-	// frame
-	int pitch;
-	SDL_LockTexture(ppu->tex, NULL, (void **)&ppu->texdata, &pitch);
-	ppu->texpitch = (size_t)pitch;
+// Returns the fine (1-pixel) y-scroll in the VRAM address
+static inline uint8_t
+fine_yscroll (ppu_t * nonnull ppu)
+{
+	return (ppu->vram_addr & PPU_VRAM_FINE_Y) >> 12;
 }
 
 // Increments the coarse (8-pixel) x-position for background scrolling,
@@ -131,8 +291,8 @@ inc_y (ppu_t * nonnull ppu)
 static inline void
 inc_vram_addr_rw (ppu_t * nonnull ppu)
 {
-	if (!(ppu->bg_en || ppu->sprite_en) || (ppu->slnum >= 240 && ppu->slnum != 261)) {
-		ppu->vram_addr = (ppu->vram_addr + (ppu->vram_addr_inc ? 32 : 1)) % 0x4000;
+	if (!rendering_en(ppu) || (ppu->slnum >= 240 && ppu->slnum != 261)) {
+		ppu->vram_addr = (ppu->vram_addr + (ppu->ctrl & PPU_CTRL_VRAM_ADDR_INC_32 ? 32 : 1)) % 0x4000;
 		return;
 	}
 	inc_coarse_x(ppu);
@@ -180,12 +340,16 @@ static inline void
 set_delayed_regs (ppu_t * nonnull ppu)
 {
 	if (ppu->sprite0_hit_shouldset) {
-		ppu->sprite0_hit = true;
+		if (!(ppu->status & PPU_STATUS_SPRITE0_HIT)) {
+			trace(ppu, PPU_TRACE_SPRITE0_HIT, 0, 0);
+		}
+		ppu->status |= PPU_STATUS_SPRITE0_HIT;
 		ppu->sprite0_hit_shouldset = false;
 	}
 
 	if (ppu->dotnum == ppu->overflow_dotnum && ppu->overflow_dotnum) {
-		ppu->sprite_overflow = true;
+		trace(ppu, PPU_TRACE_OVERFLOW, 0, 0);
+		ppu->status |= PPU_STATUS_SPRITE_OVERFLOW;
 		ppu->overflow_dotnum = 0;
 	}
 }
@@ -195,27 +359,37 @@ static inline void
 clear_regs (ppu_t * nonnull ppu)
 {
 	if (ppu->dotnum == 1 && ppu->slnum == 261) {
-		ppu->sprite0_hit           = false;
+		if (ppu->status & PPU_STATUS_VBLANK) {
+			trace(ppu, PPU_TRACE_VBLANK_CLEAR, 0, 0);
+		}
+		ppu->status                = 0;
 		ppu->sprite0_hit_shouldset = false;
-		ppu->sprite_overflow       = false;
 		ppu->write_toggle          = false;
-		ppu->vblank                = false;
 	}
 }
 
-// If rendering is enabled and the cursor is within the visible part of the
-// frame, computes and sets the appropriate pixel
-static inline void
-draw_pixel (ppu_t * ppu)
+// Returns the color emphasis bits of an output pixel
+static inline uint16_t
+emph_bits (ppu_t * nonnull ppu)
 {
-	if (!(ppu->bg_en || ppu->sprite_en) || ppu->dotnum < 1 || ppu->dotnum > 256 || ppu->slnum >= 240) {
-		return;
-	}
+	return (uint16_t)((ppu->mask & PPU_MASK_EMPH) << 1);
+}
+
+// Returns the palette memory that pixels are colored from, which depends on
+// whether greyscale mode is on
+static inline const uint8_t * nonnull
+active_palette (ppu_t * nonnull ppu)
+{
+	return (ppu->mask & PPU_MASK_GREYSCALE) ? ppu->palette_grey : ppu->palette_mem;
+}
 
+// Computes and sets the pixel under the cursor
+static inline void
+render_pixel (ppu_t * nonnull ppu)
+{
 	// Fetch the next color and palette bits from the background shiftregs
 	uint8_t bg_color = 0, bg_palette = 0;
-	bg_color   |= ((ppu->bg_bmp_shiftregs[0] << ppu->fine_xscroll) >> 15) & 0x1;
-	bg_color   |= ((ppu->bg_bmp_shiftregs[1] << ppu->fine_xscroll) >> 14) & 0x2;
+	bg_color   |= (ppu->bg_bmp_shiftreg >> (2 * ppu->fine_xscroll)) & 0x3;
 	bg_palette |= ((ppu->bg_attr_shiftregs[0] << ppu->fine_xscroll) >> 7) & 0x1;
 	bg_palette |= ((ppu->bg_attr_shiftregs[1] << ppu->fine_xscroll) >> 6) & 0x2;
 
@@ -238,27 +412,25 @@ draw_pixel (ppu_t * ppu)
 
 		if (!sprite_color) {
 			// Current sprite pixel is transparent
-			sprite_color |= (ppu->sprite_bmp_shiftregs[i][0] >> 7) & 0x1;
-			sprite_color |= (ppu->sprite_bmp_shiftregs[i][1] >> 6) & 0x2;
-			sprite_palette   = ppu->sprite_attrs[i].palette;
-			sprite_behind_bg = ppu->sprite_attrs[i].behind_bg;
+			sprite_color |= ppu->sprite_bmp_shiftregs[i] & 0x3;
+			sprite_palette   = ppu->sprite_attrs[i] & PPU_SPRITEATTR_PALETTE;
+			sprite_behind_bg = ppu->sprite_attrs[i] & PPU_SPRITEATTR_BEHIND_BG;
 			is_sprite0 = !i && ppu->scanline_has_sprite0;
 		}
 
 		// Shift the sprite shiftregs, so that the next dot gets the
 		// next pixel in the sprite
-		ppu->sprite_bmp_shiftregs[i][0] <<= 1;
-		ppu->sprite_bmp_shiftregs[i][1] <<= 1;
+		ppu->sprite_bmp_shiftregs[i] >>= 2;
 	}
 
 	// When sprites are disabled, force the sprite to be transparent
-	if (!ppu->sprite_en || (!ppu->left_sprite_en && ppu->dotnum <= 8)) {
+	if (!(ppu->mask & PPU_MASK_SPRITE_EN) || (!(ppu->mask & PPU_MASK_LEFT_SPRITE_EN) && ppu->dotnum <= 8)) {
 		sprite_color = 0;
 	}
 
 	// When the background is disabled, force the background to be
 	// transparent
-	if (!ppu->bg_en || (!ppu->left_bg_en && ppu->dotnum <= 8)) {
+	if (!(ppu->mask & PPU_MASK_BG_EN) || (!(ppu->mask & PPU_MASK_LEFT_BG_EN) && ppu->dotnum <= 8)) {
 		bg_color = 0;
 	}
 
@@ -289,18 +461,52 @@ bg:
 	paladdr = 0x3F01 + 4 * bg_palette + bg_color - 1;
 	// fallthrough
 output : {
-	uint16_t pixel_color = *palette_loc(ppu, paladdr);
-	pixel_color |= ppu->emph_red << 6;
-	pixel_color |= ppu->emph_green << 7;
-	pixel_color |= ppu->emph_blue << 8;
-
-	uint8_t * pixdata = ppu->texdata + ppu->slnum * ppu->texpitch + (ppu->dotnum - 1) * 4;
-	pixdata[0] = ppu->palette_srgb[pixel_color][0];
-	pixdata[1] = ppu->palette_srgb[pixel_color][1];
-	pixdata[2] = ppu->palette_srgb[pixel_color][2];
-	pixdata[3] = 255;
+	// Only the sprite 0 hit is observable on a skipped frame, and the
+	// framebuffer must keep the last drawn frame, exactly as
+	// `render_scanline()` leaves it
+	if (ppu->frame_skipped) {
+		return;
+	}
+
+	uint16_t * pixel = &ppu->framebuf[ppu->slnum][ppu->dotnum - 1];
+	uint16_t val = active_palette(ppu)[palette_loc(ppu, paladdr) - ppu->palette_mem] | emph_bits(ppu);
+	if (*pixel != val) {
+		ppu->dirty.rows[ppu->slnum / VIDEO_TILE_SIZE] |= 1u << ((ppu->dotnum - 1) / VIDEO_TILE_SIZE);
+	}
+	*pixel = val;
 }}
 
+// If rendering is enabled and the cursor is within the visible part of the
+// frame, computes and sets the appropriate pixel
+static inline void
+draw_pixel (ppu_t * nonnull ppu)
+{
+	if (!rendering_en(ppu) || ppu->dotnum < 1 || ppu->dotnum > 256 || ppu->slnum >= 240) {
+		return;
+	}
+	render_pixel(ppu);
+}
+
+// Sorts every sprite in OAM into the buckets of the scanlines it overlaps
+static void
+build_sprite_buckets (ppu_t * nonnull ppu)
+{
+	ppu_sprite_buckets_t * buckets = &ppu->sprite_buckets;
+	memset(buckets->nsprites, 0, sizeof(buckets->nsprites));
+
+	size_t spriteheight = ppu->ctrl & PPU_CTRL_SPRITESIZE_8x16 ? 16 : 8;
+	for (size_t spritenum = 0; spritenum < 64; spritenum++) {
+		size_t ypos = ppu->sprites[spritenum].ypos;
+		for (size_t slnum = ypos; slnum < ypos + spriteheight && slnum < PPU_OUTPUT_HEIGHT; slnum++) {
+			if (buckets->nsprites[slnum] < 8) {
+				buckets->spritenums[slnum][buckets->nsprites[slnum]++] = (uint8_t)spritenum;
+			}
+		}
+	}
+
+	buckets->stale = false;
+}
+
 // Perform the sprite evaluation process in a single step. This involves
 // determining which sprites overlap the next scanline (at most 8), saving
 // their information separately, and computing when (and if) the sprite
@@ -310,47 +516,41 @@ spriteeval (ppu_t * nonnull ppu)
 {
 	// This process is only performed on the first dot of each visible
 	// scanline, when rendering is enabled
-	if (!(ppu->bg_en || ppu->sprite_en) || ppu->dotnum != 0 || ppu->slnum >= 240) {
+	if (!rendering_en(ppu) || ppu->dotnum != 0 || ppu->slnum >= 240) {
 		return;
 	}
 
 	// Clear the state set by the last sprite evaluation
 	memset(ppu->eval_sprites, 0xFF, sizeof(ppu->eval_sprites));
-	ppu->eval_nsprites = 0;
 
 	// Propagate the `has_sprite0` flags
 	ppu->scanline_has_sprite0 = ppu->next_scanline_has_sprite0;
-	ppu->next_scanline_has_sprite0 = false;
-
-	// Evaluate sprites
-	size_t spriteheight = ppu->spritesize == PPU_SPRITESIZE_8x8 ? 8 : 16;
-	size_t spritenum = 0;
-	for (; ppu->eval_nsprites < 8 && spritenum < 64; spritenum++) {
-		ppu_sprite_t sprite = ppu->sprites[spritenum];
-		if (ppu->slnum < sprite.ypos || ppu->slnum >= sprite.ypos + spriteheight) {
-			continue;
-		}
 
-		if (!spritenum) {
-			ppu->next_scanline_has_sprite0 = true;
-		}
+	// Evaluate sprites, by way of the buckets
+	if (UNLIKELY(ppu->sprite_buckets.stale)) {
+		build_sprite_buckets(ppu);
+	}
 
-		ppu->eval_sprites[ppu->eval_nsprites] = sprite;
-		ppu->eval_nsprites++;
+	const uint8_t * spritenums = ppu->sprite_buckets.spritenums[ppu->slnum];
+	ppu->eval_nsprites = ppu->sprite_buckets.nsprites[ppu->slnum];
+	for (size_t i = 0; i < ppu->eval_nsprites; i++) {
+		ppu->eval_sprites[i] = ppu->sprites[spritenums[i]];
 	}
 
-	// Check excess sprites for overflow
-	for (; spritenum < 64; spritenum++) {
-		if (ppu->slnum >= ppu->sprites[spritenum].ypos || ppu->slnum < ppu->sprites[spritenum].ypos + spriteheight) {
-			// [https://forums.nesdev.com/viewtopic.php?f=2&t=15870]
-			// Eight cycles pass for each of the 8 sprites that we
-			// *will* render, along with 2 cycles for each of the
-			// sprites that we found not to overlap this scanline,
-			// and finally 2 cycles while examining the overflowing
-			// sprite before the overflow flag is set.
-			ppu->overflow_dotnum = 8 * 8 + (spritenum + 1 - 8) * 2;
-			break;
-		}
+	ppu->next_scanline_has_sprite0 = ppu->eval_nsprites && !spritenums[0];
+
+	// Check excess sprites for overflow. Every sprite after the eighth is
+	// treated as overlapping this scanline, so this happens whenever there
+	// are any.
+	if (ppu->eval_nsprites == 8 && spritenums[7] < 63) {
+		// [https://forums.nesdev.com/viewtopic.php?f=2&t=15870]
+		// Eight cycles pass for each of the 8 sprites that we *will*
+		// render, along with 2 cycles for each of the sprites that we
+		// found not to overlap this scanline, and finally 2 cycles
+		// while examining the overflowing sprite before the overflow
+		// flag is set.
+		size_t spritenum = spritenums[7] + 1u;
+		ppu->overflow_dotnum = 8 * 8 + (spritenum + 1 - 8) * 2;
 	}
 }
 
@@ -361,19 +561,75 @@ spriteeval (ppu_t * nonnull ppu)
 static inline uint16_t
 bg_bmp_addr (ppu_t * nonnull ppu)
 {
-	uint16_t addr = ppu->bg_chr_baseaddr == PPU_CHR_BASEADDR_1000 ? 0x1000 : 0x0000;
+	uint16_t addr = ppu->ctrl & PPU_CTRL_BG_CHR_1000 ? 0x1000 : 0x0000;
 	addr += ppu->nt_latch * 16;
-	addr += ppu->fine_yscroll;
+	addr += fine_yscroll(ppu);
 	return addr;
 }
 
-// Bitswap a byte in-place, using a small number of efficient integer
-// operations (no divisions). Stolen from
-// [https://graphics.stanford.edu/~seander/bithacks.html#ReverseByteWith64Bits].
-static inline void
-bitswap (uint8_t * nonnull val)
+// Bitmasks selecting each bitplane's bits of a row of 2-bit pixels
+#define CHR_PLANE0 0x5555
+#define CHR_PLANE1 0xAAAA
+
+// Spreads a byte of one bitplane out into the plane-0 bits of a row of 2-bit
+// pixels, moving the leftmost (most significant) pixel to the low bits unless
+// `flipped`
+static inline uint16_t
+spread_plane (uint8_t plane, bool flipped)
+{
+	uint16_t row = 0;
+	for (size_t i = 0; i < 8; i++) {
+		size_t bitnum = flipped ? i : 7 - i;
+		row |= (uint16_t)(((plane >> bitnum) & 0x1) << (2 * i));
+	}
+	return row;
+}
+
+// Decodes every row of pattern data in a data-mapped page into the CHR cache
+static void
+decode_chr_page (ppu_t * nonnull ppu, size_t pagenum, const uint8_t * nonnull data)
+{
+	ppu_chr_cache_t * cache = &ppu->chr_cache;
+	for (size_t tilenum = 0; tilenum < MEMBUS_PAGESIZE / 16; tilenum++) {
+		for (size_t rownum = 0; rownum < 8; rownum++) {
+			uint8_t plane0 = data[tilenum * 16 + rownum];
+			uint8_t plane1 = data[tilenum * 16 + rownum + 8];
+			size_t idx = (pagenum * (MEMBUS_PAGESIZE / 16) + tilenum) * 8 + rownum;
+			for (size_t flipped = 0; flipped < 2; flipped++) {
+				cache->rows[flipped][idx] = spread_plane(plane0, flipped) |
+				                            (uint16_t)(spread_plane(plane1, flipped) << 1);
+			}
+		}
+	}
+	cache->srcs[pagenum] = data;
+}
+
+// Fetches the bitplanes selected by `planes` (`CHR_PLANE0`, `CHR_PLANE1`, or
+// both) of the row of pattern data at `addr`, as 2-bit pixels. Rows that are
+// data-mapped come from the CHR cache; anything else (including the garbage
+// addresses that sprite fetches can produce) is read through the bus, one
+// byte per plane, exactly as the hardware would.
+static inline uint16_t
+fetch_chr (ppu_t * nonnull ppu, uint16_t addr, bool flipped, uint16_t planes)
 {
-	*val = ((*val * 0x80200802ULL) & 0x0884422110ULL) * 0x0101010101ULL >> 32;
+	if (LIKELY(addr < 0x2000 && !(addr & 0x8) && ppu->chr_mem[addr >> 12])) {
+		size_t pagenum = addr / MEMBUS_PAGESIZE;
+		const uint8_t * data = ppu->chr_mem[addr >> 12] + (addr & 0x0F00);
+		if (UNLIKELY(ppu->chr_cache.srcs[pagenum] != data)) {
+			decode_chr_page(ppu, pagenum, data);
+		}
+		size_t idx = ((addr >> 1) & ~0x7) | (addr & 0x7);
+		return ppu->chr_cache.rows[flipped][idx] & planes;
+	}
+
+	uint16_t row = 0;
+	if (planes & CHR_PLANE0) {
+		row |= spread_plane(membus_read(ppu->bus, addr), flipped);
+	}
+	if (planes & CHR_PLANE1) {
+		row |= (uint16_t)(spread_plane(membus_read(ppu->bus, addr + 8), flipped) << 1);
+	}
+	return row;
 }
 
 // Compute the address of the nametable byte to be fetched, based on the
@@ -394,92 +650,121 @@ attr_addr (ppu_t * nonnull ppu)
 	return 0x23C0 | (ppu->vram_addr & 0x0C00) | ((ppu->vram_addr >> 4) & 0x38) | ((ppu->vram_addr >> 2) & 0x07);
 }
 
-// Read background bitmap, nametable, and attribute table data as appropriate
-static inline void
-bg_memfetch (ppu_t * nonnull ppu)
+// Reads a byte of nametable (or attribute table) memory at `addr`, directly
+// if its nametable is plain memory, and through the bus otherwise
+static inline uint8_t
+read_nt (ppu_t * nonnull ppu, uint16_t addr)
 {
-	// Background data is fetched constantly during normal rendering, and
-	// also at the end of each visible scanline, to prepare for the next
-	if ((ppu->dotnum < 1 || ppu->dotnum > 256) && (ppu->dotnum < 321 || ppu->dotnum > 336)) {
-		return;
+	const uint8_t * mem = ppu->nt_mem[(addr >> 10) & 0x3];
+	if (LIKELY(mem)) {
+		return mem[addr & 0x3FF];
 	}
+	return membus_read(ppu->bus, addr);
+}
 
-	switch ((ppu->dotnum - 1) % 8) {
+// Performs the background fetch for the given phase of an 8-dot tile fetch
+static inline void
+fetch_bg (ppu_t * nonnull ppu, size_t phase)
+{
+	switch (phase) {
 	case 1:
-		ppu->nt_latch = membus_read(ppu->bus, nt_addr(ppu));
+		watch(ppu, nt_addr(ppu));
+		ppu->nt_latch = read_nt(ppu, nt_addr(ppu));
 		break;
 	case 3:
-		ppu->attr_latch = membus_read(ppu->bus, attr_addr(ppu));
+		watch(ppu, attr_addr(ppu));
+		ppu->attr_latch = read_nt(ppu, attr_addr(ppu));
 		break;
 	case 5:
-		ppu->bmp_latch[0] = membus_read(ppu->bus, bg_bmp_addr(ppu));
+		watch(ppu, bg_bmp_addr(ppu));
+		ppu->bmp_latch &= CHR_PLANE1;
+		ppu->bmp_latch |= fetch_chr(ppu, bg_bmp_addr(ppu), false, CHR_PLANE0);
 		break;
 	case 7:
-		ppu->bmp_latch[1] = membus_read(ppu->bus, bg_bmp_addr(ppu) + 8);
+		watch(ppu, bg_bmp_addr(ppu) + 8);
+		ppu->bmp_latch &= CHR_PLANE0;
+		ppu->bmp_latch |= fetch_chr(ppu, bg_bmp_addr(ppu), false, CHR_PLANE1);
 		break;
 	}
 }
 
-// Read sprite bitmap data as appropriate, along with some garbage bytes from
-// nametable memory. Horizontal sprite flipping is handled at this time by
-// bitswapping the loaded bitmap data.
+// Read background bitmap, nametable, and attribute table data as appropriate
 static inline void
-sprite_memfetch (ppu_t * nonnull ppu)
+bg_memfetch (ppu_t * nonnull ppu)
 {
-	// Sprite information is only fetched from dots 257 through 320
-	if (ppu->dotnum < 257 || ppu->dotnum > 320) {
+	// Background data is fetched constantly during normal rendering, and
+	// also at the end of each visible scanline, to prepare for the next
+	if ((ppu->dotnum < 1 || ppu->dotnum > 256) && (ppu->dotnum < 321 || ppu->dotnum > 336)) {
 		return;
 	}
+	fetch_bg(ppu, (ppu->dotnum - 1) % 8);
+}
 
-	size_t spritenum = (ppu->dotnum - 257) / 8;
-	ppu_sprite_t sprite = ppu->eval_sprites[spritenum];
-
+// Compute the address of the row of pattern data to be fetched for a sprite
+// found during sprite evaluation
+static inline uint16_t
+sprite_bmp_addr (ppu_t * nonnull ppu, ppu_sprite_t sprite)
+{
 	uint16_t bmp_addr;
 	uint8_t tile = sprite.tile;
-	if (ppu->spritesize) {
+	bool verti_flipped = sprite.attr & PPU_SPRITEATTR_VERTI_FLIPPED;
+	if (ppu->ctrl & PPU_CTRL_SPRITESIZE_8x16) {
 		bmp_addr = 0x1000 * (tile & 0x1);
 		tile &= ~0x1;
 	}
 	else {
-		bmp_addr = ppu->sprite_chr_baseaddr ? 0x1000 : 0x0000;
+		bmp_addr = ppu->ctrl & PPU_CTRL_SPRITE_CHR_1000 ? 0x1000 : 0x0000;
 	}
 
-	uint8_t y_offset = ppu->coarse_yscroll * 8 + ppu->fine_yscroll - 1 - sprite.ypos;
-	if (ppu->spritesize == PPU_SPRITESIZE_8x16) {
-		tile += (y_offset / 8) ^ sprite.attr.verti_flipped;
+	uint8_t y_offset = coarse_yscroll(ppu) * 8 + fine_yscroll(ppu) - 1 - sprite.ypos;
+	if (ppu->ctrl & PPU_CTRL_SPRITESIZE_8x16) {
+		tile += (y_offset / 8) ^ verti_flipped;
 		y_offset %= 8;
 	}
 
-	if (sprite.attr.verti_flipped) {
+	if (verti_flipped) {
 		y_offset = 7 - y_offset;
 	}
 
 	bmp_addr += tile * 16 + y_offset;
+	return bmp_addr;
+}
+
+// Read sprite bitmap data as appropriate, along with some garbage bytes from
+// nametable memory. Horizontal sprite flipping is handled at this time by
+// fetching flipped rows from the CHR cache.
+static inline void
+sprite_memfetch (ppu_t * nonnull ppu)
+{
+	// Sprite information is only fetched from dots 257 through 320
+	if (ppu->dotnum < 257 || ppu->dotnum > 320) {
+		return;
+	}
+
+	size_t spritenum = (ppu->dotnum - 257) / 8;
+	ppu_sprite_t sprite = ppu->eval_sprites[spritenum];
+	uint16_t bmp_addr = sprite_bmp_addr(ppu, sprite);
 
 	switch ((ppu->dotnum - 1) % 8) {
 	case 1:
+		watch(ppu, nt_addr(ppu));
 		membus_read(ppu->bus, nt_addr(ppu));
 		break;
 	case 3:
+		watch(ppu, attr_addr(ppu));
 		membus_read(ppu->bus, attr_addr(ppu));
 		break;
 	case 5:
-		ppu->sprite_bmp_shiftregs[spritenum][0] = membus_read(ppu->bus, bmp_addr);
-		if (sprite.attr.horiz_flipped) {
-			bitswap(&ppu->sprite_bmp_shiftregs[spritenum][0]);
-		}
-		if (spritenum >= ppu->eval_nsprites) {
-			ppu->sprite_bmp_shiftregs[spritenum][0] = 0;
-		}
+		watch(ppu, bmp_addr);
+		ppu->sprite_bmp_shiftregs[spritenum] &= CHR_PLANE1;
+		ppu->sprite_bmp_shiftregs[spritenum] |= fetch_chr(ppu, bmp_addr, (sprite.attr & PPU_SPRITEATTR_HORIZ_FLIPPED), CHR_PLANE0) &
+		                                        (spritenum < ppu->eval_nsprites ? CHR_PLANE0 : 0);
 		break;
 	case 7:
-		ppu->sprite_bmp_shiftregs[spritenum][1] = membus_read(ppu->bus, bmp_addr + 8);
-		if (sprite.attr.horiz_flipped) {
-			bitswap(&ppu->sprite_bmp_shiftregs[spritenum][1]);
-		}
-		if (spritenum >= ppu->eval_nsprites) {
-			ppu->sprite_bmp_shiftregs[spritenum][1] = 0;
-		}
+		watch(ppu, bmp_addr + 8);
+		ppu->sprite_bmp_shiftregs[spritenum] &= CHR_PLANE0;
+		ppu->sprite_bmp_shiftregs[spritenum] |= fetch_chr(ppu, bmp_addr, (sprite.attr & PPU_SPRITEATTR_HORIZ_FLIPPED), CHR_PLANE1) &
+		                                        (spritenum < ppu->eval_nsprites ? CHR_PLANE1 : 0);
 
 		ppu->sprite_xs[spritenum] = sprite.xpos;
 		ppu->sprite_attrs[spritenum] = sprite.attr;
@@ -488,11 +773,17 @@ sprite_memfetch (ppu_t * nonnull ppu)
 }
 
 // Perform the garbage reads that occur at the end of each visible scanline,
-// since some mappers track these reads for timing
+// since some mappers track these reads for timing: two more fetches from the
+// nametable, 2 dots each. Only the bus can tell whether they happen, so
+// `render_scanline()` leaves them out.
 static inline void
 dummy_memfetch (ppu_t * nonnull ppu)
 {
-	// TODO implement
+	if (ppu->dotnum != 338 && ppu->dotnum != 340) {
+		return;
+	}
+	watch(ppu, nt_addr(ppu));
+	read_nt(ppu, nt_addr(ppu));
 }
 
 // Perform read transfers for background and sprite data, as appropriate
@@ -501,7 +792,7 @@ memfetch (ppu_t * nonnull ppu)
 {
 	// Don't perform any transfers when rendering is disabled, or within
 	// vblank
-	if (!(ppu->bg_en || ppu->sprite_en) || (ppu->slnum >= 240 && ppu->slnum != 261)) {
+	if (!rendering_en(ppu) || (ppu->slnum >= 240 && ppu->slnum != 261)) {
 		return;
 	}
 	bg_memfetch(ppu);
@@ -515,7 +806,7 @@ static inline void
 update_vram_addr (ppu_t * nonnull ppu)
 {
 	// Do nothing if rendering is disabled
-	if (!ppu->bg_en && !ppu->sprite_en) {
+	if (!rendering_en(ppu)) {
 		return;
 	}
 
@@ -568,11 +859,26 @@ move_cursor (ppu_t * nonnull ppu)
 
 	ppu->slnum = 0;
 	ppu->framenum++;
+	ppu->frame_skipped = frame_skipped(ppu);
 }
 
 // Loads the background bitmap shift registers with new bytes previously loaded
 // from memory, and updates the attribute bit latches
 static inline void
+reload_shiftregs (ppu_t * nonnull ppu)
+{
+	ppu->bg_bmp_shiftreg &= 0xFFFF;
+	ppu->bg_bmp_shiftreg |= (uint32_t)ppu->bmp_latch << 16;
+
+	uint8_t attr_x = (coarse_xscroll(ppu) / 2) % 2;
+	uint8_t attr_y = (coarse_yscroll(ppu) / 2) % 2;
+	uint8_t attr_idx = attr_y * 2 + attr_x;
+	uint8_t attr_shift = attr_idx * 2;
+	ppu->bg_palette = (ppu->attr_latch >> attr_shift) & 0x3;
+}
+
+// Reloads the background shift registers, if this cycle is one that does so
+static inline void
 load_shiftregs (ppu_t * nonnull ppu)
 {
 	// Check if reloading actually occurs during this cycle
@@ -582,17 +888,20 @@ load_shiftregs (ppu_t * nonnull ppu)
 	    (ppu->dotnum >= 257 && ppu->dotnum <= 320)) {
 		return;
 	}
+	reload_shiftregs(ppu);
+}
 
-	ppu->bg_bmp_shiftregs[0] &= 0xFF00;
-	ppu->bg_bmp_shiftregs[1] &= 0xFF00;
-	ppu->bg_bmp_shiftregs[0] |= ppu->bmp_latch[0];
-	ppu->bg_bmp_shiftregs[1] |= ppu->bmp_latch[1];
+// Shifts the background shift registers by one pixel
+static inline void
+advance_shiftregs (ppu_t * nonnull ppu)
+{
+	// Shift zeros into the bitmap register
+	ppu->bg_bmp_shiftreg >>= 2;
 
-	uint8_t attr_x = (ppu->coarse_xscroll / 2) % 2;
-	uint8_t attr_y = (ppu->coarse_yscroll / 2) % 2;
-	uint8_t attr_idx = attr_y * 2 + attr_x;
-	uint8_t attr_shift = attr_idx * 2;
-	ppu->bg_palette = (ppu->attr_latch >> attr_shift) & 0x3;
+	// Shift the values from the attribute latches into the attribute
+	// registers
+	ppu->bg_attr_shiftregs[0] = (uint8_t)(ppu->bg_attr_shiftregs[0] << 1) | (ppu->bg_palette & 0x1);
+	ppu->bg_attr_shiftregs[1] = (uint8_t)(ppu->bg_attr_shiftregs[1] << 1) | (ppu->bg_palette >> 1);
 }
 
 // Performs the actual shift of the background shift registers
@@ -603,26 +912,18 @@ shift_shiftregs (ppu_t * nonnull ppu)
 	if (!(ppu->dotnum >= 2 && ppu->dotnum <= 257) && !(ppu->dotnum >= 322 && ppu->dotnum <= 337)) {
 		return;
 	}
-
-	// Shift zeros into the bitmap registers
-	ppu->bg_bmp_shiftregs[0] <<= 1;
-	ppu->bg_bmp_shiftregs[1] <<= 1;
-
-	// Shift the values from the attribute latches into the attribute
-	// registers
-	ppu->bg_attr_shiftregs[0] = (uint8_t)(ppu->bg_attr_shiftregs[0] << 1) | (ppu->bg_palette & 0x1);
-	ppu->bg_attr_shiftregs[1] = (uint8_t)(ppu->bg_attr_shiftregs[1] << 1) | (ppu->bg_palette >> 1);
+	advance_shiftregs(ppu);
 }
 
-static void
+// Emulates a single dot
+static inline void
 step (ppu_t * nonnull ppu)
 {
-	ppu->clk_countdown = PPU_CLKDIVISOR;
-
 	if (ppu->slnum == 241 && ppu->dotnum == 1) {
-		ppu->vblank = true;
-		if (ppu->nmi_en) {
-			mos6502_raise_nmi(ppu->cpu);
+		ppu->status |= PPU_STATUS_VBLANK;
+		trace(ppu, PPU_TRACE_VBLANK_SET, 0, 0);
+		if (ppu->ctrl & PPU_CTRL_NMI_EN) {
+			raise_nmi(ppu);
 		}
 		present_frame(ppu);
 	}
@@ -641,69 +942,501 @@ step (ppu_t * nonnull ppu)
 	move_cursor(ppu);
 }
 
-// TODO handle latent values in PPU registers
-static uint8_t
-read (ppu_t * nonnull ppu, uint16_t addr)
+// Flags set in the per-scanline sprite buffer, alongside each opaque sprite
+// pixel's 2-bit color and 2-bit palette
+#define SPRITE_PIXEL_BEHIND_BG 0x10
+#define SPRITE_PIXEL_SPRITE0   0x20
+
+// Returns the background pixel under the cursor as its offset into palette
+// memory (a 2-bit palette and 2-bit color), or 0 if it's transparent
+static inline uint8_t
+bg_pixel (ppu_t * nonnull ppu)
 {
-	uint8_t val = 0, *palloc = NULL;
-	uint16_t regnum = addr % 8;
-	switch (regnum) {
-	case 2: // PPUSTATUS
-		val |= ppu->vblank << 7;
-		val |= ppu->sprite0_hit << 6;
-		val |= ppu->sprite_overflow << 5;
+	uint8_t color = (ppu->bg_bmp_shiftreg >> (2 * ppu->fine_xscroll)) & 0x3;
+	if (!color || !(ppu->mask & PPU_MASK_BG_EN) || (!(ppu->mask & PPU_MASK_LEFT_BG_EN) && ppu->dotnum <= 8)) {
+		return 0;
+	}
 
-		ppu->write_toggle = false;
-		ppu->vblank = false;
-		break;
+	uint8_t palette = 0;
+	palette |= ((ppu->bg_attr_shiftregs[0] << ppu->fine_xscroll) >> 7) & 0x1;
+	palette |= ((ppu->bg_attr_shiftregs[1] << ppu->fine_xscroll) >> 6) & 0x2;
+	return (uint8_t)(palette << 2) | color;
+}
 
-	case 4: // OAMDATA
-		val = ppu->oam[ppu->oam_addr];
-		break;
+// Draws the opaque pixels of every sprite on the scanline into `line`, so that
+// each pixel ends up belonging to the highest-priority sprite there. Also
+// leaves the sprite registers as 256 dots' worth of `render_pixel()` would.
+static inline void
+fill_sprite_line (ppu_t * nonnull ppu, uint8_t * nonnull line)
+{
+	memset(line, 0, PPU_OUTPUT_WIDTH);
 
-	case 7: // PPUDATA
-		if ((palloc = palette_loc(ppu, ppu->vram_addr))) {
-			val = *palloc;
+	for (size_t i = 8; i-- > 0;) {
+		// A sprite's x-position counts down once per dot (starting at
+		// dot 1) until it reaches 0, and from then on one pixel is
+		// shifted out per dot
+		size_t start = ppu->sprite_xs[i] ? ppu->sprite_xs[i] - 1u : 0;
+		size_t nshifted = PPU_OUTPUT_WIDTH - start;
+		uint16_t row = ppu->sprite_bmp_shiftregs[i];
+
+		ppu->sprite_xs[i] = 0;
+		ppu->sprite_bmp_shiftregs[i] = nshifted < 8 ? (uint16_t)(row >> (2 * nshifted)) : 0;
+
+		if (!(ppu->mask & PPU_MASK_SPRITE_EN)) {
+			continue;
 		}
-		else {
-			val = ppu->vram_read_buf; // pass back the buffered value
-			if (ppu->vram_addr >= 0x3000 && ppu->vram_addr < 0x3F00) 
-				ppu->vram_read_buf = membus_read(ppu->bus, ppu->vram_addr - 0x1000);
-			else 
-				ppu->vram_read_buf = membus_read(ppu->bus, ppu->vram_addr); // update internal buffer
+
+		uint8_t flags = (uint8_t)((ppu->sprite_attrs[i] & PPU_SPRITEATTR_PALETTE) << 2);
+		if (ppu->sprite_attrs[i] & PPU_SPRITEATTR_BEHIND_BG) {
+			flags |= SPRITE_PIXEL_BEHIND_BG;
+		}
+		if (!i && ppu->scanline_has_sprite0) {
+			flags |= SPRITE_PIXEL_SPRITE0;
 		}
-		inc_vram_addr_rw(ppu);
-		break;
 
-	default:
-		val = 0xFF;
-		break;
+		for (size_t j = 0; j < 8 && start + j < PPU_OUTPUT_WIDTH; j++) {
+			uint8_t color = (row >> (2 * j)) & 0x3;
+			if (color) {
+				line[start + j] = flags | color;
+			}
+		}
 	}
 
-	return val;
+	if (!(ppu->mask & PPU_MASK_LEFT_SPRITE_EN)) {
+		memset(line, 0, 8);
+	}
 }
 
-static void
-write (ppu_t * nonnull ppu, uint16_t addr, uint8_t val)
+// Returns the dot on which a sprite 0 hit found while composing a scanline from
+// `bg_line` and `sprite_line` would have been flagged, which is the one after
+// the first pixel that hit. Only tracing needs to know this.
+static size_t
+sprite0_hit_dot (const uint8_t * nonnull bg_line, const uint8_t * nonnull sprite_line)
 {
-	uint8_t * palloc = NULL;
-	uint16_t regnum = addr % 8;
-	switch (regnum) {
-	case 0: // PPUCTRL
-		ppu->tmp_nt_baseaddr     = val & 0x3;
-		ppu->vram_addr_inc       = !!(val & 0x4);
-		ppu->sprite_chr_baseaddr = !!(val & 0x8);
-		ppu->bg_chr_baseaddr     = !!(val & 0x10);
-		ppu->spritesize          = !!(val & 0x20);
-		// ignore EXT mode select
-
-		bool old_nmi_en = ppu->nmi_en;
-		ppu->nmi_en = !!(val & 0x80);
-		if (ppu->nmi_en != old_nmi_en && ppu->vblank) {
-			mos6502_raise_nmi(ppu->cpu);
+	for (size_t x = 0; x < PPU_OUTPUT_WIDTH - 1; x++) {
+		if (bg_line[x] && (sprite_line[x] & SPRITE_PIXEL_SPRITE0)) {
+			return x + 2;
 		}
+	}
+	UNREACHABLE();
+	return 0;
+}
 
-		break;
+// Resolves the priority of the background and sprite pixels across a whole
+// scanline, outputs the resulting pixels, and sets the sprite 0 hit flag if
+// they collide. The effect is the same as `render_pixel()` on dots 1-256,
+// given the background pixels that it would have seen in `bg_line`.
+//
+// Pixels are resolved to offsets into palette memory; an opaque sprite pixel
+// wins if the background is transparent or the sprite is in front of it. The
+// mirrors of the backdrop color at $3F10/$3F14/$3F18/$3F1C can never come out
+// of this, so palette memory can be indexed directly. Each pixel is compared
+// with what it replaces on the way out, to mark the tiles that changed.
+static inline void
+compose_scanline (ppu_t * nonnull ppu, const uint8_t * nonnull bg_line)
+{
+	uint8_t sprite_line[PPU_OUTPUT_WIDTH];
+	fill_sprite_line(ppu, sprite_line);
+
+	uint16_t * pixels = ppu->framebuf[ppu->slnum];
+	const uint8_t * palette = active_palette(ppu);
+	uint16_t emph = emph_bits(ppu);
+	uint32_t hits = 0;
+	// The tiles along the line that come out differently than they were
+	uint32_t changed = 0;
+	size_t x = 0;
+
+	// The line is a whole number of vectors wide, so there's never a
+	// scalar tail to take care of
+
+#if defined(__AVX2__)
+	// Palette memory is looked up with a byte shuffle on each of its
+	// 16-byte halves
+	__m256i palette_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)&palette[0x00]));
+	__m256i palette_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)&palette[0x10]));
+
+	for (; x + 32 <= PPU_OUTPUT_WIDTH; x += 32) {
+		__m256i zero = _mm256_setzero_si256();
+		__m256i bg = _mm256_loadu_si256((const __m256i *)&bg_line[x]);
+		__m256i sprite = _mm256_loadu_si256((const __m256i *)&sprite_line[x]);
+
+		__m256i bg_clear = _mm256_cmpeq_epi8(bg, zero);
+		__m256i sprite_clear = _mm256_cmpeq_epi8(sprite, zero);
+		__m256i sprite_front = _mm256_cmpeq_epi8(_mm256_and_si256(sprite, _mm256_set1_epi8(SPRITE_PIXEL_BEHIND_BG)), zero);
+		__m256i sprite0 = _mm256_cmpeq_epi8(_mm256_and_si256(sprite, _mm256_set1_epi8(SPRITE_PIXEL_SPRITE0)),
+		                                    _mm256_set1_epi8(SPRITE_PIXEL_SPRITE0));
+
+		__m256i use_sprite = _mm256_andnot_si256(sprite_clear, _mm256_or_si256(bg_clear, sprite_front));
+		__m256i sprite_idx = _mm256_or_si256(_mm256_and_si256(sprite, _mm256_set1_epi8(0x0F)), _mm256_set1_epi8(0x10));
+		__m256i idx = _mm256_blendv_epi8(bg, sprite_idx, use_sprite);
+
+		__m256i hit = _mm256_andnot_si256(bg_clear, _mm256_andnot_si256(sprite_clear, sprite0));
+		hits |= (uint32_t)_mm256_movemask_epi8(hit) & (x + 32 == PPU_OUTPUT_WIDTH ? 0x7FFFFFFF : 0xFFFFFFFF);
+
+		__m256i nibble = _mm256_and_si256(idx, _mm256_set1_epi8(0x0F));
+		__m256i in_hi = _mm256_cmpeq_epi8(_mm256_and_si256(idx, _mm256_set1_epi8(0x10)), _mm256_set1_epi8(0x10));
+		__m256i colors = _mm256_blendv_epi8(_mm256_shuffle_epi8(palette_lo, nibble),
+		                                    _mm256_shuffle_epi8(palette_hi, nibble), in_hi);
+
+		__m256i emph_lanes = _mm256_set1_epi16((short)emph);
+		__m256i lo = _mm256_or_si256(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(colors)), emph_lanes);
+		__m256i hi = _mm256_or_si256(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(colors, 1)), emph_lanes);
+
+		// Each half of each vector of pixels is one tile
+		uint32_t same_lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(lo, _mm256_loadu_si256((const __m256i *)&pixels[x])));
+		uint32_t same_hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(hi, _mm256_loadu_si256((const __m256i *)&pixels[x + 16])));
+		changed |= (uint32_t)((uint16_t)same_lo != 0xFFFF) << (x / 8);
+		changed |= (uint32_t)((same_lo >> 16) != 0xFFFF) << (x / 8 + 1);
+		changed |= (uint32_t)((uint16_t)same_hi != 0xFFFF) << (x / 8 + 2);
+		changed |= (uint32_t)((same_hi >> 16) != 0xFFFF) << (x / 8 + 3);
+
+		_mm256_storeu_si256((__m256i *)&pixels[x], lo);
+		_mm256_storeu_si256((__m256i *)&pixels[x + 16], hi);
+	}
+#elif defined(__SSE2__)
+	for (; x + 16 <= PPU_OUTPUT_WIDTH; x += 16) {
+		__m128i zero = _mm_setzero_si128();
+		__m128i bg = _mm_loadu_si128((const __m128i *)&bg_line[x]);
+		__m128i sprite = _mm_loadu_si128((const __m128i *)&sprite_line[x]);
+
+		__m128i bg_clear = _mm_cmpeq_epi8(bg, zero);
+		__m128i sprite_clear = _mm_cmpeq_epi8(sprite, zero);
+		__m128i sprite_front = _mm_cmpeq_epi8(_mm_and_si128(sprite, _mm_set1_epi8(SPRITE_PIXEL_BEHIND_BG)), zero);
+		__m128i sprite0 = _mm_cmpeq_epi8(_mm_and_si128(sprite, _mm_set1_epi8(SPRITE_PIXEL_SPRITE0)),
+		                                 _mm_set1_epi8(SPRITE_PIXEL_SPRITE0));
+
+		__m128i use_sprite = _mm_andnot_si128(sprite_clear, _mm_or_si128(bg_clear, sprite_front));
+		__m128i sprite_idx = _mm_or_si128(_mm_and_si128(sprite, _mm_set1_epi8(0x0F)), _mm_set1_epi8(0x10));
+		__m128i idx = _mm_or_si128(_mm_and_si128(use_sprite, sprite_idx), _mm_andnot_si128(use_sprite, bg));
+
+		__m128i hit = _mm_andnot_si128(bg_clear, _mm_andnot_si128(sprite_clear, sprite0));
+		hits |= (uint32_t)_mm_movemask_epi8(hit) & (x + 16 == PPU_OUTPUT_WIDTH ? 0x7FFF : 0xFFFF);
+
+		uint8_t idxs[16];
+		uint16_t colors[16];
+		_mm_storeu_si128((__m128i *)idxs, idx);
+		for (size_t i = 0; i < 16; i++) {
+			colors[i] = palette[idxs[i]] | emph;
+		}
+
+		// Each vector of pixels is one tile
+		for (size_t i = 0; i < 16; i += 8) {
+			__m128i vals = _mm_loadu_si128((const __m128i *)&colors[i]);
+			__m128i same = _mm_cmpeq_epi16(vals, _mm_loadu_si128((const __m128i *)&pixels[x + i]));
+			changed |= (uint32_t)(_mm_movemask_epi8(same) != 0xFFFF) << ((x + i) / 8);
+			_mm_storeu_si128((__m128i *)&pixels[x + i], vals);
+		}
+	}
+#else
+	for (; x < PPU_OUTPUT_WIDTH; x++) {
+		uint8_t bg = bg_line[x], sprite = sprite_line[x], idx = bg;
+		if (sprite && (!bg || !(sprite & SPRITE_PIXEL_BEHIND_BG))) {
+			idx = 0x10 | (sprite & 0x0F);
+		}
+		if (bg && (sprite & SPRITE_PIXEL_SPRITE0) && x != PPU_OUTPUT_WIDTH - 1) {
+			hits = 1;
+		}
+		uint16_t val = palette[idx] | emph;
+		if (pixels[x] != val) {
+			changed |= 1u << (x / 8);
+		}
+		pixels[x] = val;
+	}
+#endif
+
+	// Sprite 0 hits would have been flagged on the following dot
+	if (hits) {
+		if (UNLIKELY(ppu->trace) && !(ppu->status & PPU_STATUS_SPRITE0_HIT)) {
+			trace_in_line(ppu, PPU_TRACE_SPRITE0_HIT, sprite0_hit_dot(bg_line, sprite_line));
+		}
+		ppu->status |= PPU_STATUS_SPRITE0_HIT;
+	}
+
+	ppu->dirty.rows[ppu->slnum / VIDEO_TILE_SIZE] |= changed;
+}
+
+// Works like `fetch_bg()`, except that both bitplanes of the tile's row are
+// fetched in one go from the CHR cache, on the later of the two dots. This is
+// only valid when the fetches are unobserved, and nothing writes to CHR memory
+// in-between.
+static inline void
+fetch_bg_fast (ppu_t * nonnull ppu, size_t phase)
+{
+	switch (phase) {
+	case 1:
+		ppu->nt_latch = read_nt(ppu, nt_addr(ppu));
+		break;
+	case 3:
+		ppu->attr_latch = read_nt(ppu, attr_addr(ppu));
+		break;
+	case 7:
+		ppu->bmp_latch = fetch_chr(ppu, bg_bmp_addr(ppu), false, CHR_PLANE0 | CHR_PLANE1);
+		break;
+	}
+}
+
+// Returns the row of 2-bit background pixels that the scanline starting at the
+// cursor takes from its `tilenum`th tile (counting the two already in the
+// shift registers), exactly as its fetches would find it
+static inline uint16_t
+bg_tile_row (ppu_t * nonnull ppu, size_t tilenum)
+{
+	if (tilenum < 2) {
+		return (uint16_t)(ppu->bg_bmp_shiftreg >> (16 * tilenum));
+	}
+
+	// The later tiles are fetched after one coarse x-increment each,
+	// which wraps into the horizontally adjacent nametable at most once
+	size_t coarse_x = coarse_xscroll(ppu) + tilenum - 2;
+	uint16_t vram_addr = (uint16_t)((ppu->vram_addr & ~0x001F) | (coarse_x & 0x1F));
+	if (coarse_x & 0x20) {
+		vram_addr ^= 0x0400;
+	}
+
+	uint16_t addr = ppu->ctrl & PPU_CTRL_BG_CHR_1000 ? 0x1000 : 0x0000;
+	addr += read_nt(ppu, 0x2000 | (vram_addr & 0x0FFF)) * 16;
+	addr += fine_yscroll(ppu);
+	return fetch_chr(ppu, addr, false, CHR_PLANE0 | CHR_PLANE1);
+}
+
+// Predicts whether sprite 0 hits the background on the scanline starting at
+// the cursor, without drawing it. Only sprite 0's opaque pixels are tested,
+// against the (at most two) background tiles under them, under the same rules
+// as `compose_scanline()`. Returns the dot the hit would be flagged on, or 0
+// if there isn't one.
+static inline size_t
+predict_sprite0_hit (ppu_t * nonnull ppu)
+{
+	if (!ppu->scanline_has_sprite0 || (ppu->mask & PPU_MASK_RENDERING_EN) != PPU_MASK_RENDERING_EN) {
+		return 0;
+	}
+
+	size_t start = ppu->sprite_xs[0] ? ppu->sprite_xs[0] - 1u : 0;
+	uint16_t sprite_row = ppu->sprite_bmp_shiftregs[0];
+	size_t tilenum = SIZE_MAX;
+	uint16_t bg_row = 0;
+
+	// Hits are never flagged on the last pixel of the line
+	for (size_t j = 0; j < 8 && start + j < PPU_OUTPUT_WIDTH - 1; j++) {
+		size_t x = start + j;
+		if (!((sprite_row >> (2 * j)) & 0x3) || (x < 8 && (ppu->mask & (PPU_MASK_LEFT_BG_EN | PPU_MASK_LEFT_SPRITE_EN)) != (PPU_MASK_LEFT_BG_EN | PPU_MASK_LEFT_SPRITE_EN))) {
+			continue;
+		}
+
+		size_t pos = ppu->fine_xscroll + x;
+		if (pos / 8 != tilenum) {
+			tilenum = pos / 8;
+			bg_row = bg_tile_row(ppu, tilenum);
+		}
+		if ((bg_row >> (2 * (pos % 8))) & 0x3) {
+			return x + 2;
+		}
+	}
+	return 0;
+}
+
+// Tells the mapper watching A12 (if any) about the edges that the fetches of
+// the scanline being rendered all at once make, exactly as `step()` would,
+// without making them. Every even dot from 2 to 340 fetches, and only the
+// pattern fetches (the last two of each 8 dots) can have A12 set. This must
+// be called once the VRAM address has moved on to the next row on dot 257,
+// since the rows that sprites are fetched from depend on it. The empty sprite
+// slots fetch from garbage rows, which can carry into A12, even between one
+// bitplane and the next.
+static void
+watch_scanline_a12 (ppu_t * nonnull ppu)
+{
+	uint16_t bg_addr = ppu->ctrl & PPU_CTRL_BG_CHR_1000 ? 0x1000 : 0x0000;
+	uint16_t sprite_addrs[8];
+	for (size_t spritenum = 0; spritenum < 8; spritenum++) {
+		sprite_addrs[spritenum] = sprite_bmp_addr(ppu, ppu->eval_sprites[spritenum]);
+	}
+
+	for (size_t dotnum = 2; dotnum <= 340; dotnum += 2) {
+		size_t phase = (dotnum - 1) % 8;
+		uint16_t addr = 0x0000;
+		if (phase >= 5 && (dotnum <= 256 || (dotnum >= 321 && dotnum <= 336))) {
+			addr = bg_addr;
+		}
+		else if (phase >= 5 && dotnum >= 257 && dotnum <= 320) {
+			addr = sprite_addrs[(dotnum - 257) / 8] + (phase == 7 ? 8 : 0);
+		}
+		watch_at(ppu, addr, ppu->synced_cyclenum + dotnum * PPU_CLKDIVISOR);
+	}
+}
+
+// Emulates all 341 dots of a visible scanline at once, starting from dot 0.
+// The effect is exactly that of calling `step()` for each of them, but each
+// stage of the pipeline only runs on the dots that it would actually do
+// something on, rather than testing for them on every dot. This is only valid
+// when rendering stays enabled for the whole line, and when the PPU's fetches
+// are unobserved (this skips the garbage ones, and does the sprite fetches in
+// a single batch).
+static inline void
+render_scanline (ppu_t * nonnull ppu)
+{
+	ASSERT(ppu->dotnum == 0 && ppu->slnum < 240);
+
+	set_delayed_regs(ppu);
+	spriteeval(ppu);
+
+	if (UNLIKELY(ppu->frame_skipped)) {
+		// Nothing is drawn, so of dots 1-256 only the sprite 0 hit
+		// and the coarse x-increments are observable. The background
+		// shift registers and latches they would leave behind are
+		// entirely replaced by the fetches on dots 321-337, as are the
+		// sprite registers by the fetches on dots 259-320.
+		size_t hit_dotnum = predict_sprite0_hit(ppu);
+		if (hit_dotnum) {
+			if (!(ppu->status & PPU_STATUS_SPRITE0_HIT)) {
+				trace_in_line(ppu, PPU_TRACE_SPRITE0_HIT, hit_dotnum);
+			}
+			ppu->status |= PPU_STATUS_SPRITE0_HIT;
+		}
+		for (size_t i = 0; i < 31; i++) {
+			inc_coarse_x(ppu);
+		}
+	}
+	else {
+		// Dots 1-256 output pixels, while fetching the tiles two
+		// ahead. The background pixels are collected, and composited
+		// with the sprites afterwards.
+		uint8_t bg_line[PPU_OUTPUT_WIDTH];
+		for (ppu->dotnum = 1; ppu->dotnum <= 256; ppu->dotnum++) {
+			size_t phase = (ppu->dotnum - 1) % 8;
+			if (phase) {
+				fetch_bg_fast(ppu, phase);
+				advance_shiftregs(ppu);
+			}
+			else if (ppu->dotnum != 1) {
+				advance_shiftregs(ppu);
+				reload_shiftregs(ppu);
+				inc_coarse_x(ppu);
+			}
+
+			bg_line[ppu->dotnum - 1] = bg_pixel(ppu);
+		}
+
+		compose_scanline(ppu, bg_line);
+	}
+
+	// Sprite evaluation always schedules the overflow flag for a dot
+	// before 177
+	if (ppu->overflow_dotnum && ppu->overflow_dotnum <= 256) {
+		trace_in_line(ppu, PPU_TRACE_OVERFLOW, ppu->overflow_dotnum);
+		ppu->status |= PPU_STATUS_SPRITE_OVERFLOW;
+		ppu->overflow_dotnum = 0;
+	}
+	ppu->dotnum = 257;
+
+	// Dot 257 moves on to the next row of tiles
+	advance_shiftregs(ppu);
+	inc_coarse_x(ppu);
+	inc_y(ppu);
+
+	// Dot 258 resets the horizontal scroll
+	ppu->vram_addr &= ~0x041F;
+	ppu->vram_addr |= ppu->tmp_vram_addr & 0x041F;
+
+	if (UNLIKELY(ppu->watcher.obj)) {
+		watch_scanline_a12(ppu);
+	}
+
+	// Dots 259-320 fetch the bitmaps of the sprites on the next line
+	for (size_t spritenum = 0; spritenum < 8; spritenum++) {
+		ppu_sprite_t sprite = ppu->eval_sprites[spritenum];
+		ppu->sprite_bmp_shiftregs[spritenum] = 0;
+		if (spritenum < ppu->eval_nsprites) {
+			uint16_t bmp_addr = sprite_bmp_addr(ppu, sprite);
+			ppu->sprite_bmp_shiftregs[spritenum] =
+				fetch_chr(ppu, bmp_addr, (sprite.attr & PPU_SPRITEATTR_HORIZ_FLIPPED), CHR_PLANE0 | CHR_PLANE1);
+		}
+		ppu->sprite_xs[spritenum] = sprite.xpos;
+		ppu->sprite_attrs[spritenum] = sprite.attr;
+	}
+
+	// Dots 321-337 fetch the first two tiles of the next line
+	for (ppu->dotnum = 322; ppu->dotnum <= 337; ppu->dotnum++) {
+		size_t phase = (ppu->dotnum - 1) % 8;
+		if (phase) {
+			fetch_bg_fast(ppu, phase);
+			advance_shiftregs(ppu);
+		}
+		else {
+			advance_shiftregs(ppu);
+			reload_shiftregs(ppu);
+			inc_coarse_x(ppu);
+		}
+	}
+
+	// Dots 338-340 do nothing observable
+	ppu->dotnum = 340;
+	move_cursor(ppu);
+}
+
+// Returns the number of dots that will be emulated before the one on which
+// vblank begins (scanline 241, dot 1), counting from the cursor
+static inline uint64_t
+dots_until_vblank (ppu_t * nonnull ppu)
+{
+	uint64_t pos = ppu->slnum * 341 + ppu->dotnum;
+	uint64_t vblank_pos = 241 * 341 + 1;
+	if (pos <= vblank_pos) {
+		return vblank_pos - pos;
+	}
+
+	// The pre-render scanline is a dot short on odd frames
+	uint64_t frame_length = 262 * 341 - ppu->framenum % 2;
+	return frame_length - pos + vblank_pos;
+}
+
+// Emulates every dot up to clock cycle `cyclenum`
+static void
+catch_up (ppu_t * nonnull ppu, uint64_t cyclenum)
+{
+	while (ppu->synced_cyclenum + PPU_CLKDIVISOR <= cyclenum) {
+#ifndef PPU_DOT_ACCURATE
+		// Nothing can happen partway through a scanline that we're
+		// catching up on entirely, so render it in one go if we can
+		if (ppu->dotnum == 0 && ppu->slnum < 240 && rendering_en(ppu) &&
+		    ppu->synced_cyclenum + 341 * PPU_CLKDIVISOR <= cyclenum &&
+		    ppu->fetches_unobserved) {
+			render_scanline(ppu);
+			ppu->synced_cyclenum += 341 * PPU_CLKDIVISOR;
+			continue;
+		}
+#endif
+		step(ppu);
+		ppu->synced_cyclenum += PPU_CLKDIVISOR;
+	}
+}
+
+// Applies a write to register `regnum`
+static void
+apply_write (ppu_t * nonnull ppu, uint8_t regnum, uint8_t val)
+{
+	trace(ppu, PPU_TRACE_WRITE, regnum, val);
+
+	uint8_t * palloc = NULL;
+	switch (regnum) {
+	case 0: // PPUCTRL
+		ppu->tmp_vram_addr &= ~PPU_VRAM_NT;
+		ppu->tmp_vram_addr |= (uint16_t)((val & 0x3) << 10);
+
+		// The nametable select bits were just moved into
+		// `tmp_vram_addr`; ignore EXT mode select
+		val &= ~0x43;
+		uint8_t changed = ppu->ctrl ^ val;
+		ppu->ctrl = val;
+
+		if (changed & PPU_CTRL_SPRITESIZE_8x16) {
+			ppu->sprite_buckets.stale = true;
+		}
+		if ((changed & PPU_CTRL_NMI_EN) && (ppu->status & PPU_STATUS_VBLANK)) {
+			raise_nmi(ppu);
+		}
+
+		break;
 
 	case 1: // PPUMASK
 		ppu->mask = val;
@@ -715,16 +1448,19 @@ write (ppu_t * nonnull ppu, uint16_t addr, uint8_t val)
 
 	case 4: // OAMDATA
 		ppu->oam[ppu->oam_addr++] = val;
+		ppu->sprite_buckets.stale = true;
 		break;
 
 	case 5: // PPUSCROLL
 		if (!ppu->write_toggle) {
-			ppu->tmp_coarse_xscroll = val >> 3;
-			ppu->fine_xscroll       = val & 0x7;
+			ppu->tmp_vram_addr &= ~PPU_VRAM_COARSE_X;
+			ppu->tmp_vram_addr |= val >> 3;
+			ppu->fine_xscroll   = val & 0x7;
 		}
 		else {
-			ppu->tmp_coarse_yscroll = val >> 3;
-			ppu->tmp_fine_yscroll   = val & 0x7;
+			ppu->tmp_vram_addr &= ~(PPU_VRAM_COARSE_Y | PPU_VRAM_FINE_Y);
+			ppu->tmp_vram_addr |= (uint16_t)((val >> 3) << 5);
+			ppu->tmp_vram_addr |= (uint16_t)((val & 0x7) << 12);
 		}
 		ppu->write_toggle = !ppu->write_toggle;
 		break;
@@ -739,13 +1475,17 @@ write (ppu_t * nonnull ppu, uint16_t addr, uint8_t val)
 			ppu->tmp_vram_addr &= 0xFF00;
 			ppu->tmp_vram_addr |= val;
 			ppu->vram_addr = ppu->tmp_vram_addr;
+			trace(ppu, PPU_TRACE_VRAM_ADDR, regnum, ppu->vram_addr);
+			watch(ppu, ppu->vram_addr);
 		}
 		ppu->write_toggle = !ppu->write_toggle;
 		break;
 
 	case 7: // PPUDATA
+		watch(ppu, ppu->vram_addr);
 		if ((palloc = palette_loc(ppu, ppu->vram_addr))) {
 			*palloc = val;
+			ppu->palette_grey[palloc - ppu->palette_mem] = val & 0x30;
 		}
 		else {
 			// this is a mirror
@@ -753,38 +1493,369 @@ write (ppu_t * nonnull ppu, uint16_t addr, uint8_t val)
 				membus_write(ppu->bus, ppu->vram_addr - 0x1000, val);
 			else
 				membus_write(ppu->bus, ppu->vram_addr, val);
+
+			// the write may have changed CHR-RAM under the cache
+			if (ppu->vram_addr < 0x2000) {
+				ppu->chr_cache.srcs[ppu->vram_addr / MEMBUS_PAGESIZE] = NULL;
+			}
+		}
+
+		inc_vram_addr_rw(ppu);
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Copies `src` into OAM, starting at OAMADDR
+static void
+copy_oam (ppu_t * nonnull ppu, const uint8_t * nonnull src)
+{
+	trace(ppu, PPU_TRACE_OAMDMA, 0, ppu->oam_addr);
+
+	size_t nhigh = sizeof(ppu->oam) - ppu->oam_addr;
+	memcpy(&ppu->oam[ppu->oam_addr], src, nhigh);
+	memcpy(ppu->oam, src + nhigh, ppu->oam_addr);
+	ppu->sprite_buckets.stale = true;
+}
+
+// How many times either thread spins waiting on the other before going to
+// sleep, if they can run at the same time
+#define WORKER_NSPINS 1024
+
+static inline void
+spin_pause (void)
+{
+#if defined(__SSE2__)
+	_mm_pause();
+#endif
+}
+
+// Signals `cond` if the thread waiting on it is asleep (as told by `asleep`),
+// after something it's waiting for has been published
+static inline void
+signal_if_asleep (ppu_worker_t * nonnull worker, atomic_bool * nonnull asleep, pthread_cond_t * nonnull cond)
+{
+	// The (sequentially consistent) store that published it is ordered
+	// before checking whether the other thread has gone to sleep, which it
+	// only does after checking (the other way around) that it has nothing
+	// to wait for
+	if (atomic_load(asleep)) {
+		pthread_mutex_lock(&worker->lock);
+		pthread_cond_signal(cond);
+		pthread_mutex_unlock(&worker->lock);
+	}
+}
+
+static inline void
+wake_worker (ppu_worker_t * nonnull worker)
+{
+	signal_if_asleep(worker, &worker->sleeping, &worker->wake);
+}
+
+// Returns whether the CPU thread has published anything since the PPU thread
+// last looked at `seq`, `horizon`, and `head`
+static inline bool
+worker_has_news (ppu_worker_t * nonnull worker, size_t seq, uint64_t horizon, size_t head)
+{
+	return atomic_load(&worker->sync_seq) != seq ||
+	       atomic_load(&worker->horizon) != horizon ||
+	       atomic_load(&worker->head) != head ||
+	       atomic_load(&worker->stopping);
+}
+
+static void * nullable
+run_worker (void * nonnull arg)
+{
+	ppu_t * ppu = arg;
+	ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+
+	size_t tail = atomic_load_explicit(&worker->tail, memory_order_relaxed);
+	while (true) {
+		// The sequence number is read first, so that once every write
+		// logged and the horizon published before it have been taken
+		// care of, it can be acknowledged
+		size_t seq = atomic_load_explicit(&worker->sync_seq, memory_order_acquire);
+		uint64_t horizon = atomic_load_explicit(&worker->horizon, memory_order_acquire);
+		size_t head = atomic_load_explicit(&worker->head, memory_order_acquire);
+
+		if (tail != head) {
+			for (; tail != head; tail++) {
+				ppu_log_entry_t entry = worker->log[tail % PPU_LOG_LEN];
+				catch_up(ppu, entry.cyclenum);
+
+				if (entry.regnum == PPU_LOG_OAMDMA) {
+					size_t dma_tail = atomic_load_explicit(&worker->dma_tail, memory_order_relaxed);
+					copy_oam(ppu, worker->dma_pages[dma_tail % PPU_LOG_DMA_LEN]);
+					atomic_store_explicit(&worker->dma_tail, dma_tail + 1, memory_order_release);
+				}
+				else {
+					apply_write(ppu, entry.regnum, entry.val);
+				}
+				atomic_store_explicit(&worker->tail, tail + 1, memory_order_release);
+			}
+			continue;
+		}
+
+		if (ppu->synced_cyclenum + PPU_CLKDIVISOR <= horizon) {
+			catch_up(ppu, horizon);
+			continue;
+		}
+
+		if (atomic_load_explicit(&worker->acked_seq, memory_order_relaxed) != seq) {
+			atomic_store(&worker->acked_seq, seq);
+			signal_if_asleep(worker, &worker->waiting, &worker->acked);
+		}
+		if (atomic_load_explicit(&worker->stopping, memory_order_acquire)) {
+			break;
+		}
+
+		// The CPU thread is usually only a little way ahead, so spin
+		// for a while before going to sleep
+		bool news = false;
+		for (size_t i = 0; i < worker->nspins && !news; i++) {
+			spin_pause();
+			news = worker_has_news(worker, seq, horizon, head);
+		}
+		if (!news) {
+			pthread_mutex_lock(&worker->lock);
+			atomic_store(&worker->sleeping, true);
+			while (!worker_has_news(worker, seq, horizon, head)) {
+				pthread_cond_wait(&worker->wake, &worker->lock);
+			}
+			atomic_store(&worker->sleeping, false);
+			pthread_mutex_unlock(&worker->lock);
+		}
+	}
+
+	return NULL;
+}
+
+// Starts the PPU thread, the first time the CPU thread has anything for it
+static inline void
+start_worker (ppu_t * nonnull ppu)
+{
+	ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+	if (worker->running) {
+		return;
+	}
+
+	if (pthread_create(&worker->thread, NULL, run_worker, ppu)) {
+		ERROR_PRINT("Could not start the PPU thread");
+		exit(EXIT_FAILURE);
+	}
+	worker->running = true;
+}
+
+// Lets the PPU thread run up to the current cycle
+static inline void
+publish_horizon (ppu_t * nonnull ppu)
+{
+	ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+	start_worker(ppu);
+	atomic_store(&worker->horizon, ppu->cpu->tk->clk_cyclenum);
+	wake_worker(worker);
+}
+
+// Waits for the PPU thread to catch up to the current cycle, then raises the
+// NMI or quits if it asked to along the way
+static void
+sync_worker (ppu_t * nonnull ppu)
+{
+	ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+	publish_horizon(ppu);
+
+	size_t seq = atomic_load_explicit(&worker->sync_seq, memory_order_relaxed) + 1;
+	atomic_store(&worker->sync_seq, seq);
+	wake_worker(worker);
+
+	bool acked = false;
+	for (size_t i = 0; i < worker->nspins && !acked; i++) {
+		spin_pause();
+		acked = atomic_load_explicit(&worker->acked_seq, memory_order_acquire) == seq;
+	}
+	if (!acked) {
+		pthread_mutex_lock(&worker->lock);
+		atomic_store(&worker->waiting, true);
+		while (atomic_load(&worker->acked_seq) != seq) {
+			pthread_cond_wait(&worker->acked, &worker->lock);
 		}
+		atomic_store(&worker->waiting, false);
+		pthread_mutex_unlock(&worker->lock);
+	}
+	worker->nsyncs++;
+
+	if (worker->nmi_pending) {
+		worker->nmi_pending = false;
+		mos6502_raise_nmi(ppu->cpu);
+	}
+	if (worker->quit_pending) {
+		quit(ppu);
+	}
+}
+
+// Logs a write to register `regnum`, for the PPU thread to apply once it has
+// caught up to the current cycle
+static inline void
+log_write (ppu_t * nonnull ppu, uint8_t regnum, uint8_t val)
+{
+	ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+	start_worker(ppu);
+
+	size_t head = atomic_load_explicit(&worker->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&worker->tail, memory_order_acquire) == PPU_LOG_LEN) {
+		sync_worker(ppu);
+	}
+
+	worker->log[head % PPU_LOG_LEN] = (ppu_log_entry_t){
+		.cyclenum = ppu->cpu->tk->clk_cyclenum,
+		.regnum   = regnum,
+		.val      = val,
+	};
+	atomic_store(&worker->head, head + 1);
+	wake_worker(worker);
+	worker->nlogged++;
+}
+
+void
+ppu_sync (ppu_t * ppu)
+{
+	if (ppu->worker) {
+		sync_worker(ppu);
+	}
+	else {
+		catch_up(ppu, ppu->cpu->tk->clk_cyclenum);
+	}
+}
+
+// Fires every scanline if the PPU has a thread of its own, so that it can keep
+// up with the CPU between writes
+static void
+horizon_timer (ppu_t * nonnull ppu)
+{
+	publish_horizon(ppu);
+	((ppu_worker_t * nonnull)ppu->worker)->horizon_countdown = 341 * PPU_CLKDIVISOR;
+}
+
+// Fires on the cycle that vblank begins, so that frames are presented and NMIs
+// raised on time even if the CPU never touches the PPU
+static void
+vblank_timer (ppu_t * nonnull ppu)
+{
+	ppu_sync(ppu);
+
+	uint64_t vblank_cyclenum = ppu->synced_cyclenum + (dots_until_vblank(ppu) + 1) * PPU_CLKDIVISOR;
+	ppu->clk_countdown = vblank_cyclenum - ppu->cpu->tk->clk_cyclenum;
+}
 
+// TODO handle latent values in PPU registers
+static uint8_t
+read (ppu_t * nonnull ppu, uint16_t addr)
+{
+	ppu_sync(ppu);
+
+	uint8_t val = 0, *palloc = NULL;
+	uint16_t regnum = addr % 8;
+	switch (regnum) {
+	case 2: // PPUSTATUS
+		val = ppu->status;
+		if (val & PPU_STATUS_VBLANK) {
+			trace(ppu, PPU_TRACE_VBLANK_CLEAR, 0, 0);
+		}
+
+		ppu->write_toggle = false;
+		ppu->status &= ~PPU_STATUS_VBLANK;
+		break;
+
+	case 4: // OAMDATA
+		val = ppu->oam[ppu->oam_addr];
+		break;
+
+	case 7: // PPUDATA
+		watch(ppu, ppu->vram_addr);
+		if ((palloc = palette_loc(ppu, ppu->vram_addr))) {
+			// Greyscale mode applies to reads, too
+			val = active_palette(ppu)[palloc - ppu->palette_mem];
+		}
+		else {
+			val = ppu->vram_read_buf; // pass back the buffered value
+			if (ppu->vram_addr >= 0x3000 && ppu->vram_addr < 0x3F00) 
+				ppu->vram_read_buf = membus_read(ppu->bus, ppu->vram_addr - 0x1000);
+			else 
+				ppu->vram_read_buf = membus_read(ppu->bus, ppu->vram_addr); // update internal buffer
+		}
 		inc_vram_addr_rw(ppu);
 		break;
 
 	default:
+		val = 0xFF;
 		break;
 	}
+
+	trace(ppu, PPU_TRACE_READ, (uint8_t)regnum, val);
+	return val;
+}
+
+static void
+write (ppu_t * nonnull ppu, uint16_t addr, uint8_t val)
+{
+	uint8_t regnum = addr % 8;
+
+	if (ppu->worker) {
+		ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+
+		// Toggling NMI raises it straight away during vblank, so that
+		// has to be done in step with the CPU; anything else can wait
+		bool nmi_en = worker->nmi_en;
+		if (regnum == 0) {
+			worker->nmi_en = val & PPU_CTRL_NMI_EN;
+		}
+		if (nmi_en == worker->nmi_en) {
+			log_write(ppu, regnum, val);
+			return;
+		}
+	}
+
+	ppu_sync(ppu);
+	apply_write(ppu, regnum, val);
+
+	if (ppu->worker && ppu->worker->nmi_pending) {
+		ppu->worker->nmi_pending = false;
+		mos6502_raise_nmi(ppu->cpu);
+	}
 }
 
 static void
 reset (ppu_t * nonnull ppu)
 {
-	ppu->framenum      = 0;
-	ppu->clk_countdown = PPU_CLKDIVISOR;
+	// Emulation starts over from cycle 0, which the PPU thread must not
+	// be partway through catching up to
+	if (ppu->worker) {
+		ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+		if (worker->running) {
+			sync_worker(ppu);
+		}
+		atomic_store(&worker->horizon, 0);
+		worker->horizon_countdown = 341 * PPU_CLKDIVISOR;
+		worker->nmi_en = false;
+	}
+
+	ppu->framenum = 0;
+	ppu->frame_skipped = frame_skipped(ppu);
 
 	ppu->slnum           = 261;
 	ppu->dotnum          = 0;
 	ppu->overflow_dotnum = 0;
 
-	ppu->mask = 0;
+	ppu->synced_cyclenum = 0;
+	ppu->clk_countdown   = (dots_until_vblank(ppu) + 1) * PPU_CLKDIVISOR;
 
-	ppu->vram_addr_inc       = 0;
-	ppu->bg_chr_baseaddr     = 0;
-	ppu->sprite_chr_baseaddr = 0;
-	ppu->spritesize          = 0;
+	ppu->ctrl   = 0;
+	ppu->mask   = 0;
+	ppu->status = 0;
 
-	ppu->nmi_en          = 0;
-	ppu->vblank          = 0;
-	ppu->sprite0_hit     = 0;
-	ppu->sprite_overflow = 0;
-	ppu->write_toggle    = 0;
+	ppu->write_toggle = 0;
 
 	ppu->sprite0_hit_shouldset = 0;
 
@@ -798,28 +1869,63 @@ reset (ppu_t * nonnull ppu)
 	ppu->fine_xscroll = 0;
 
 	memset(ppu->oam, 0x00, sizeof(ppu->oam));
+	ppu->sprite_buckets.stale = true;
 	memset(ppu->palette_mem, 0x00, sizeof(ppu->palette_mem));
+	memset(ppu->palette_grey, 0x00, sizeof(ppu->palette_grey));
+
+	memset(ppu->chr_cache.srcs, 0x00, sizeof(ppu->chr_cache.srcs));
+
+	ppu->watcher.a12_high = false;
+	ppu->watcher.a12_fell_cyclenum = 0;
+}
+
+static void
+deinit_worker (ppu_worker_t * nonnull worker)
+{
+	pthread_cond_destroy(&worker->acked);
+	pthread_cond_destroy(&worker->wake);
+	pthread_mutex_destroy(&worker->lock);
 }
 
 static void
 deinit (ppu_t * nonnull ppu)
 {
+	ppu_finish(ppu);
 	rc_release(ppu->bus);
-
-	SDL_DestroyTexture(ppu->tex);
-	SDL_DestroyRenderer(ppu->rend);
-	SDL_DestroyWindow(ppu->win);
-	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+	if (ppu->worker) {
+		rc_release((ppu_worker_t * nonnull)ppu->worker);
+	}
+	if (ppu->watcher.obj) {
+		rc_release((void * nonnull)ppu->watcher.obj);
+	}
 }
 
 ppu_t *
-ppu_new (reset_manager_t * rm, mos6502_t * cpu, int scale)
+ppu_new (reset_manager_t * rm, mos6502_t * cpu, const video_config_t * video, video_palette_t * palette)
 {
+	ASSERT(video->frameskip > 0);
+
 	ppu_t * ppu = rc_alloc(sizeof(ppu_t), deinit);
 	reset_manager_add_device(rm, ppu, reset);
-	timekeeper_add_timer(cpu->tk, ppu, step, &ppu->clk_countdown);
+	timekeeper_add_timer(cpu->tk, ppu, vblank_timer, &ppu->clk_countdown);
 
 	ppu->cpu = cpu;
+	ppu->frameskip = video->frameskip;
+	ppu->nframes = video->nframes;
+
+	if (video->ppu_thread) {
+		ppu_worker_t * worker = rc_alloc(sizeof(ppu_worker_t), deinit_worker);
+		pthread_mutex_init(&worker->lock, NULL);
+		pthread_cond_init(&worker->wake, NULL);
+		pthread_cond_init(&worker->acked, NULL);
+		worker->nspins = WORKER_NSPINS;
+		if (get_nprocs() < 2) {
+			ERROR_PRINT("Only one CPU is online, so the PPU thread will slow emulation down");
+			worker->nspins = 0;
+		}
+		ppu->worker = worker;
+		timekeeper_add_timer(cpu->tk, ppu, horizon_timer, &worker->horizon_countdown);
+	}
 
 	membus_t * nullable bus = membus_new(rm);
 	if (!bus) {
@@ -827,63 +1933,210 @@ ppu_new (reset_manager_t * rm, mos6502_t * cpu, int scale)
 	}
 	ppu->bus = (membus_t * nonnull)bus;
 
-	if (SDL_InitSubSystem(SDL_INIT_VIDEO)) {
-		ERROR_PRINT("Could not init SDL video: %s", SDL_GetError());
-		goto initerror;
-	}
-
-	ppu->win = SDL_CreateWindow(
-		"Hawknest",
-		SDL_WINDOWPOS_CENTERED,
-		SDL_WINDOWPOS_CENTERED,
-		PPU_OUTPUT_WIDTH * scale,
-		PPU_OUTPUT_HEIGHT * scale,
-		SDL_WINDOW_ALLOW_HIGHDPI);
+	// Every page the PPU fetches from is data-mapped, and nothing can
+	// observe the PPU bus's lanes, so its reads needn't track them
+	membus_set_open_bus(ppu->bus, MEMBUS_OPEN_BUS_IGNORE);
 
-	if (!ppu->win) {
-		ERROR_PRINT("Could not create window: %s", SDL_GetError());
-		goto winerror;
+	if (video->frame_hashes_path) {
+		ppu->frame_hashes = try_fopen((const char * nonnull)video->frame_hashes_path, "w");
+		if (!ppu->frame_hashes) {
+			goto videoerror;
+		}
 	}
 
-	ppu->rend = SDL_CreateRenderer(ppu->win, -1, SDL_RENDERER_PRESENTVSYNC);
-	if (!ppu->rend) {
-		ERROR_PRINT("Could not create renderer: %s", SDL_GetError());
-		goto renderror;
+	if (video->capture_path) {
+		ppu->capture = capture_new((const char * nonnull)video->capture_path, palette);
+		if (!ppu->capture) {
+			goto videoerror;
+		}
 	}
 
-	// Make sure the texture stays pixelated if `scale > 1`.
-	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
-
-	// Create the texture, setting the access mode to `STREAMING` so that
-	// we can efficiently replace its contents.
-	ppu->tex = SDL_CreateTexture(
-		ppu->rend,
-		SDL_PIXELFORMAT_RGBA32,
-		SDL_TEXTUREACCESS_STREAMING,
-		PPU_OUTPUT_WIDTH,
-		PPU_OUTPUT_HEIGHT);
+	if (video->trace_path) {
+		ppu->trace = ppu_trace_new((const char * nonnull)video->trace_path);
+	}
 
-	if (!ppu->tex) {
-		ERROR_PRINT("Could not create texture: %s", SDL_GetError());
-		goto texerror;
+	if (video_sink_open(&ppu->video, video, palette)) {
+		goto videoerror;
 	}
 
-	int pitch;
-	SDL_LockTexture(ppu->tex, NULL, (void **)&ppu->texdata, &pitch);
-	ppu->texpitch = (size_t)pitch;
+	for (size_t y = 0; y < PPU_OUTPUT_HEIGHT; y++) {
+		for (size_t x = 0; x < PPU_OUTPUT_WIDTH; x++) {
+			ppu->framebuf[y][x] = PPU_PIXEL_BLANK;
+		}
+	}
 
 	return ppu;
-texerror:
-	SDL_DestroyRenderer(ppu->rend);
-renderror:
-	SDL_DestroyWindow(ppu->win);
-winerror:
+videoerror:
 	rc_release(ppu);
-	SDL_QuitSubSystem(SDL_INIT_VIDEO);
 initerror:
 	return NULL;
 }
 
+void
+ppu_finish (ppu_t * ppu)
+{
+	if (ppu->worker && ppu->worker->running) {
+		ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+
+		pthread_mutex_lock(&worker->lock);
+		atomic_store(&worker->stopping, true);
+		pthread_cond_signal(&worker->wake);
+		pthread_mutex_unlock(&worker->lock);
+
+		pthread_join(worker->thread, NULL);
+		worker->running = false;
+
+		INFO_PRINT("PPU thread applied %zu logged writes, and was waited for %zu times",
+			   worker->nlogged,
+			   worker->nsyncs);
+	}
+
+	video_sink_close(&ppu->video);
+
+	if (ppu->frame_hashes) {
+		fclose((FILE * nonnull)ppu->frame_hashes);
+		ppu->frame_hashes = NULL;
+	}
+
+	if (ppu->capture) {
+		capture_t * capture = (capture_t * nonnull)ppu->capture;
+		capture_stop(capture);
+		capture_print_stats(capture);
+		rc_release(capture);
+		ppu->capture = NULL;
+	}
+
+	if (ppu->trace) {
+		ppu_trace_t * trace = (ppu_trace_t * nonnull)ppu->trace;
+		ppu_trace_dump(trace);
+		rc_release(trace);
+		ppu->trace = NULL;
+	}
+}
+
+// Makes `obj` the PPU's watcher, with the routines in `watcher`
+static int
+set_watcher (ppu_t * nonnull ppu, void * nonnull obj, ppu_watcher_t watcher)
+{
+	if (ppu->worker) {
+		ERROR_PRINT("This mapper watches the PPU's address bus, which the PPU thread can't do in step with the CPU");
+		return -1;
+	}
+
+	ppu_sync(ppu);
+	if (ppu->watcher.obj) {
+		rc_release((void * nonnull)ppu->watcher.obj);
+	}
+	watcher.obj = rc_retain(obj);
+	ppu->watcher = watcher;
+	ppu_remap(ppu);
+	return 0;
+}
+
+int
+ppu_watch_a12 (ppu_t * ppu, void * obj, void * rise)
+{
+	return set_watcher(ppu, obj, (ppu_watcher_t){.a12_rise = rise});
+}
+
+int
+ppu_watch_fetches (ppu_t * ppu, void * obj, void * fetch)
+{
+	return set_watcher(ppu, obj, (ppu_watcher_t){.fetch = fetch});
+}
+
+void
+ppu_set_palette (ppu_t * ppu, video_palette_t * palette)
+{
+	// Frames are handed to the sink from the PPU thread, if there is one
+	ppu_sync(ppu);
+
+	if (ppu->video.set_palette) {
+		ppu->video.set_palette((void * nonnull)ppu->video.obj, palette);
+	}
+}
+
+uint64_t
+ppu_frame_hash (ppu_t * ppu)
+{
+	return hash64(ppu->framebuf, sizeof(ppu->framebuf), 0);
+}
+
+ppu_view_t
+ppu_view (ppu_t * ppu)
+{
+	ppu_sync(ppu);
+
+	ppu_view_t view = {
+		.sprites = ppu->sprites,
+		.oam = ppu->oam,
+		.palette = ppu->palette_mem,
+	};
+	memcpy(view.nametables, ppu->nt_mem, sizeof(view.nametables));
+	return view;
+}
+
+void
+ppu_oam_dma (ppu_t * ppu, const uint8_t * src)
+{
+	if (ppu->worker) {
+		ppu_worker_t * worker = (ppu_worker_t * nonnull)ppu->worker;
+		start_worker(ppu);
+		if (worker->dma_head - atomic_load_explicit(&worker->dma_tail, memory_order_acquire) == PPU_LOG_DMA_LEN) {
+			sync_worker(ppu);
+		}
+		memcpy(worker->dma_pages[worker->dma_head % PPU_LOG_DMA_LEN], src, 256);
+		worker->dma_head++;
+		log_write(ppu, PPU_LOG_OAMDMA, 0);
+		return;
+	}
+
+	ppu_sync(ppu);
+	copy_oam(ppu, src);
+}
+
+// Returns the memory that `npages` pages of the bus starting at `pagenum` are
+// data-mapped to, or NULL if any of them aren't, or aren't contiguous
+static const uint8_t * nullable
+resolve_pages (membus_t * nonnull bus, size_t pagenum, size_t npages)
+{
+	const uint8_t * base = NULL;
+	for (size_t i = 0; i < npages; i++) {
+		if (!bus->read_mappings[pagenum + i].obj || bus->read_mappings[pagenum + i].offset_p1) {
+			return NULL;
+		}
+		const uint8_t * data = bus->read_mappings[pagenum + i].data;
+		if (i == 0) {
+			base = data;
+		} else if (data != base + i * MEMBUS_PAGESIZE) {
+			return NULL;
+		}
+	}
+	return base;
+}
+
+void
+ppu_remap (ppu_t * ppu)
+{
+	for (size_t i = 0; i < 4; i++) {
+		ppu->nt_mem[i] = resolve_pages(ppu->bus, (0x2000 + i * 0x400) / MEMBUS_PAGESIZE, 0x400 / MEMBUS_PAGESIZE);
+	}
+	for (size_t i = 0; i < 2; i++) {
+		ppu->chr_mem[i] = resolve_pages(ppu->bus, (i * 0x1000) / MEMBUS_PAGESIZE, 0x1000 / MEMBUS_PAGESIZE);
+	}
+
+	// Pattern tables and nametables span $0000-$2FFF; if any of it is
+	// handler-mapped, something (e.g. a mapper) can observe the order the
+	// PPU's fetches happen in, so every one of them must be emulated. The
+	// same goes if a mapper is watching every fetch.
+	ppu->fetches_unobserved = !ppu->watcher.fetch;
+	for (size_t pagenum = 0x00; pagenum < 0x30; pagenum++) {
+		if (ppu->bus->read_mappings[pagenum].obj && ppu->bus->read_mappings[pagenum].offset_p1) {
+			ppu->fetches_unobserved = false;
+		}
+	}
+}
+
 void
 ppu_map (ppu_t * ppu)
 {
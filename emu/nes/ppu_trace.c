@@ -0,0 +1,80 @@
+#include <rc.h>
+#include <base.h>
+#include <fileio.h>
+#include <nes/ppu.h>
+#include <nes/ppu_trace.h>
+
+#include <errno.h>
+#include <string.h>
+
+ppu_trace_t *
+ppu_trace_new (const char * path)
+{
+	ppu_trace_t * trace = rc_alloc(sizeof(ppu_trace_t), NULL);
+	trace->path = path;
+	return trace;
+}
+
+static inline void
+put_le16 (uint8_t * nonnull p, uint16_t val)
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)(val >> 8);
+}
+
+static inline void
+put_le64 (uint8_t * nonnull p, uint64_t val)
+{
+	for (size_t i = 0; i < 8; i++) {
+		p[i] = (uint8_t)(val >> (8 * i));
+	}
+}
+
+int
+ppu_trace_dump (ppu_trace_t * trace)
+{
+	FILE * f = try_fopen(trace->path, "wb");
+	if (!f) {
+		return -1;
+	}
+
+	uint8_t header[16];
+	memcpy(header, "HKPT", 4);
+	header[4] = PPU_TRACE_VERSION;
+	header[5] = sizeof(ppu_trace_record_t);
+	put_le16(header + 6, PPU_CLKDIVISOR);
+	put_le64(header + 8, trace->nrecorded);
+	if (fwrite(header, sizeof(header), 1, f) != 1) {
+		goto writeerror;
+	}
+
+	size_t start = trace->nrecorded > PPU_TRACE_LEN ? trace->nrecorded - PPU_TRACE_LEN : 0;
+	for (size_t i = start; i < trace->nrecorded; i++) {
+		const ppu_trace_record_t * record = &trace->records[i % PPU_TRACE_LEN];
+		uint8_t bytes[sizeof(ppu_trace_record_t)];
+		put_le64(bytes, record->cyclenum);
+		put_le16(bytes + 8, record->slnum);
+		put_le16(bytes + 10, record->dotnum);
+		put_le16(bytes + 12, record->val);
+		bytes[14] = record->event;
+		bytes[15] = record->regnum;
+		if (fwrite(bytes, sizeof(bytes), 1, f) != 1) {
+			goto writeerror;
+		}
+	}
+
+	if (fclose(f)) {
+		ERROR_PRINT("Error writing %s: %s", trace->path, strerror(errno));
+		return -1;
+	}
+
+	INFO_PRINT("Dumped the last %zu of %zu PPU events to %s",
+		   trace->nrecorded - start,
+		   trace->nrecorded,
+		   trace->path);
+	return 0;
+writeerror:
+	ERROR_PRINT("Error writing %s: %s", trace->path, strerror(errno));
+	fclose(f);
+	return -1;
+}
@@ -0,0 +1,296 @@
+#include <rc.h>
+#include <base.h>
+#include <nes/presenter.h>
+#include <SDL2/SDL.h>
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#endif
+
+_Static_assert(PPU_PIXEL_BLANK == VIDEO_PALETTE_LEN, "blank pixels must index the palette's last texel");
+
+// Converts `frame` to RGBA32 texels, with rows `pitch` bytes apart. Must be
+// called with `presenter->lock` held, so the palette isn't swapped out from
+// under it.
+static void
+convert_frame (presenter_t * nonnull presenter,
+	       const uint16_t (* nonnull frame)[PPU_OUTPUT_WIDTH],
+	       uint8_t * nonnull texels,
+	       size_t pitch)
+{
+	const uint32_t * lut = presenter->palette->rgba;
+
+	for (size_t y = 0; y < PPU_OUTPUT_HEIGHT; y++) {
+		const uint16_t * pixels = frame[y];
+		uint8_t * row = texels + y * pitch;
+#if defined(__AVX2__)
+		for (size_t x = 0; x < PPU_OUTPUT_WIDTH; x += 8) {
+			__m256i idx = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&pixels[x]));
+			__m256i rgba = _mm256_i32gather_epi32((const int *)lut, idx, 4);
+			_mm256_storeu_si256((__m256i *)&row[x * 4], rgba);
+		}
+#else
+		for (size_t x = 0; x < PPU_OUTPUT_WIDTH; x++) {
+			memcpy(&row[x * 4], &lut[pixels[x]], sizeof(lut[0]));
+		}
+#endif
+	}
+}
+
+// Creates the window, renderer, and texture. Returns a nonzero exit code (after
+// printing an error) if any of them can't be.
+static int
+open_window (presenter_t * nonnull presenter)
+{
+	if (SDL_InitSubSystem(SDL_INIT_VIDEO)) {
+		ERROR_PRINT("Could not init SDL video: %s", SDL_GetError());
+		goto initerror;
+	}
+
+	presenter->win = SDL_CreateWindow(
+		"Hawknest",
+		SDL_WINDOWPOS_CENTERED,
+		SDL_WINDOWPOS_CENTERED,
+		PPU_OUTPUT_WIDTH * presenter->scale,
+		PPU_OUTPUT_HEIGHT * presenter->scale,
+		SDL_WINDOW_ALLOW_HIGHDPI);
+
+	if (!presenter->win) {
+		ERROR_PRINT("Could not create window: %s", SDL_GetError());
+		goto winerror;
+	}
+
+	presenter->rend = SDL_CreateRenderer(presenter->win, -1, SDL_RENDERER_PRESENTVSYNC);
+	if (!presenter->rend) {
+		ERROR_PRINT("Could not create renderer: %s", SDL_GetError());
+		goto renderror;
+	}
+
+	// Make sure the texture stays pixelated if `scale > 1`.
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+
+	// Create the texture, setting the access mode to `STREAMING` so that
+	// we can efficiently replace its contents.
+	presenter->tex = SDL_CreateTexture(
+		presenter->rend,
+		SDL_PIXELFORMAT_RGBA32,
+		SDL_TEXTUREACCESS_STREAMING,
+		PPU_OUTPUT_WIDTH * (presenter->ntsc ? presenter->ntsc->scale : 1),
+		PPU_OUTPUT_HEIGHT);
+
+	if (!presenter->tex) {
+		ERROR_PRINT("Could not create texture: %s", SDL_GetError());
+		goto texerror;
+	}
+
+	return 0;
+texerror:
+	SDL_DestroyRenderer(presenter->rend);
+renderror:
+	SDL_DestroyWindow(presenter->win);
+winerror:
+	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+initerror:
+	return -1;
+}
+
+// Takes the newest complete frame for display, if there's one that hasn't
+// been taken yet. Returns whether there was.
+static inline bool
+take_frame (presenter_t * nonnull presenter)
+{
+	if (!(atomic_load_explicit(&presenter->ready, memory_order_acquire) & PRESENTER_FRESH)) {
+		return false;
+	}
+
+	unsigned ready = atomic_exchange_explicit(&presenter->ready, presenter->reading, memory_order_acq_rel);
+	presenter->reading = ready & ~PRESENTER_FRESH;
+	return true;
+}
+
+static void * nullable
+run (void * nonnull arg)
+{
+	presenter_t * presenter = arg;
+
+	int status = open_window(presenter) ? -1 : 1;
+	pthread_mutex_lock(&presenter->lock);
+	presenter->status = status;
+	pthread_cond_signal(&presenter->started);
+	pthread_mutex_unlock(&presenter->lock);
+	if (status < 0) {
+		return NULL;
+	}
+
+	// Presenting blocks until the next vsync, which paces this loop; if
+	// the renderer can't sync, frames are only presented as they arrive
+	SDL_RendererInfo info;
+	bool vsync = !SDL_GetRendererInfo(presenter->rend, &info) && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+	bool shown = false;
+
+	while (!atomic_load_explicit(&presenter->stopping, memory_order_relaxed)) {
+		SDL_Event event;
+		while (SDL_PollEvent(&event)) {
+			if (event.type == SDL_QUIT) {
+				atomic_store(&presenter->quit_requested, true);
+			}
+		}
+
+		// A new palette recolors the frame on screen, even if the
+		// emulation is paused (e.g. in the shell)
+		bool recolor = atomic_exchange_explicit(&presenter->recolor, false, memory_order_relaxed);
+		if (take_frame(presenter) || (recolor && shown && !presenter->ntsc)) {
+			void * texels;
+			int pitch;
+			SDL_LockTexture(presenter->tex, NULL, &texels, &pitch);
+			if (presenter->ntsc) {
+				ntsc_filter((ntsc_t * nonnull)presenter->ntsc,
+					    presenter->framenums[presenter->reading],
+					    presenter->frames[presenter->reading],
+					    texels,
+					    (size_t)pitch);
+			}
+			else {
+				pthread_mutex_lock(&presenter->lock);
+				convert_frame(presenter, presenter->frames[presenter->reading], texels, (size_t)pitch);
+				pthread_mutex_unlock(&presenter->lock);
+			}
+			SDL_UnlockTexture(presenter->tex);
+			shown = true;
+		}
+		else if (shown && vsync) {
+			atomic_fetch_add_explicit(&presenter->nrepeated, 1, memory_order_relaxed);
+		}
+		else {
+			SDL_Delay(1);
+			continue;
+		}
+
+		SDL_RenderCopy(presenter->rend, presenter->tex, NULL, NULL);
+		SDL_RenderPresent(presenter->rend);
+	}
+
+	SDL_DestroyTexture(presenter->tex);
+	SDL_DestroyRenderer(presenter->rend);
+	SDL_DestroyWindow(presenter->win);
+	SDL_QuitSubSystem(SDL_INIT_VIDEO);
+	return NULL;
+}
+
+static void
+deinit (presenter_t * nonnull presenter)
+{
+	presenter_stop(presenter);
+	pthread_cond_destroy(&presenter->started);
+	pthread_mutex_destroy(&presenter->lock);
+	rc_release(presenter->palette);
+	if (presenter->ntsc) {
+		rc_release((ntsc_t * nonnull)presenter->ntsc);
+	}
+}
+
+presenter_t *
+presenter_new (int scale, int ntsc, video_palette_t * palette)
+{
+	presenter_t * presenter = rc_alloc(sizeof(presenter_t), deinit);
+	presenter->scale = scale;
+	presenter->palette = rc_retain(palette);
+	if (ntsc) {
+		presenter->ntsc = ntsc_new(ntsc);
+	}
+
+	for (size_t i = 0; i < 3; i++) {
+		for (size_t y = 0; y < PPU_OUTPUT_HEIGHT; y++) {
+			for (size_t x = 0; x < PPU_OUTPUT_WIDTH; x++) {
+				presenter->frames[i][y][x] = PPU_PIXEL_BLANK;
+			}
+		}
+	}
+	presenter->writing = 0;
+	atomic_init(&presenter->ready, 1);
+	presenter->reading = 2;
+
+	pthread_mutex_init(&presenter->lock, NULL);
+	pthread_cond_init(&presenter->started, NULL);
+
+	if (pthread_create(&presenter->thread, NULL, run, presenter)) {
+		ERROR_PRINT("Could not start the presentation thread");
+		goto error;
+	}
+	presenter->running = true;
+
+	pthread_mutex_lock(&presenter->lock);
+	while (!presenter->status) {
+		pthread_cond_wait(&presenter->started, &presenter->lock);
+	}
+	pthread_mutex_unlock(&presenter->lock);
+
+	if (presenter->status < 0) {
+		goto error;
+	}
+
+	return presenter;
+error:
+	rc_release(presenter);
+	return NULL;
+}
+
+void
+presenter_submit (presenter_t * presenter, size_t framenum, const uint16_t (* frame)[PPU_OUTPUT_WIDTH])
+{
+	memcpy(presenter->frames[presenter->writing], frame, sizeof(presenter->frames[0]));
+	presenter->framenums[presenter->writing] = framenum;
+
+	unsigned ready = atomic_exchange_explicit(&presenter->ready,
+	                                          presenter->writing | PRESENTER_FRESH,
+	                                          memory_order_acq_rel);
+	presenter->writing = ready & ~PRESENTER_FRESH;
+
+	atomic_fetch_add_explicit(&presenter->nsubmitted, 1, memory_order_relaxed);
+	if (ready & PRESENTER_FRESH) {
+		atomic_fetch_add_explicit(&presenter->ndropped, 1, memory_order_relaxed);
+	}
+}
+
+void
+presenter_set_palette (presenter_t * presenter, video_palette_t * palette)
+{
+	// The old palette is released here rather than on the presentation
+	// thread, since it may belong to the machine's arena
+	pthread_mutex_lock(&presenter->lock);
+	video_palette_t * old = presenter->palette;
+	presenter->palette = rc_retain(palette);
+	pthread_mutex_unlock(&presenter->lock);
+
+	rc_release(old);
+	atomic_store_explicit(&presenter->recolor, true, memory_order_relaxed);
+}
+
+bool
+presenter_quit_requested (presenter_t * presenter)
+{
+	return atomic_load_explicit(&presenter->quit_requested, memory_order_relaxed);
+}
+
+void
+presenter_stop (presenter_t * presenter)
+{
+	if (!presenter->running) {
+		return;
+	}
+
+	atomic_store(&presenter->stopping, true);
+	pthread_join(presenter->thread, NULL);
+	presenter->running = false;
+}
+
+void
+presenter_print_stats (presenter_t * presenter)
+{
+	INFO_PRINT("Submitted %zu frames (%zu dropped, %zu repeated)",
+		   atomic_load(&presenter->nsubmitted),
+		   atomic_load(&presenter->ndropped),
+		   atomic_load(&presenter->nrepeated));
+}
@@ -89,6 +89,7 @@ remap (sxrom_t * cart)
 			(cart->mmc1.reg2.banksel4k * 0x1000) % cart->chrom->size);
 		break;
 	}
+	ppu_remap(cart->ppu);
 
 	// TODO wram_en?
 	if (cart->wram) {
@@ -120,6 +121,10 @@ static void
 reg_write (sxrom_t * cart, size_t addr, uint8_t val)
 {
 	mmc1_reg_write(&cart->mmc1, addr / 0x2000, val, (cart->cpu->tk->clk_cyclenum / MOS6502_CLKDIVISOR));
+
+	// The PPU must finish any dots it owes under the old banking before
+	// the new one takes effect
+	ppu_sync(cart->ppu);
 	remap(cart);
 }
 
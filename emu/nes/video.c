@@ -0,0 +1,243 @@
+#include <rc.h>
+#include <base.h>
+#include <fileio.h>
+#include <nes/ppu.h>
+#include <nes/video.h>
+#include <nes/presenter.h>
+
+#include <errno.h>
+#include <string.h>
+
+_Static_assert(VIDEO_FRAME_WIDTH == PPU_OUTPUT_WIDTH && VIDEO_FRAME_HEIGHT == PPU_OUTPUT_HEIGHT,
+               "video frames must be the size of the PPU's output");
+
+// Frames are swapped through the presenter's triple buffer whole, and it may
+// drop them, so it has no previous frame to only update the dirty tiles of
+static void
+sdl_write_frame (presenter_t * nonnull presenter,
+		 size_t framenum,
+		 const uint16_t (* nonnull frame)[PPU_OUTPUT_WIDTH],
+		 const video_dirty_t * nonnull dirty)
+{
+	presenter_submit(presenter, framenum, frame);
+}
+
+static void
+sdl_set_palette (presenter_t * nonnull presenter, video_palette_t * nonnull palette)
+{
+	presenter_set_palette(presenter, palette);
+}
+
+static void
+sdl_close (presenter_t * nonnull presenter)
+{
+	presenter_stop(presenter);
+	presenter_print_stats(presenter);
+}
+
+// Appends frames to a file as raw RGB24
+typedef struct raw_sink {
+	FILE * nonnull /*owned*/ f;
+	const char * nonnull /*unowned*/ path;
+	video_palette_t * nonnull /*strong*/ palette;
+	size_t nframes;
+	bool failed;
+
+	// The last frame written, which starts out black like the pixels
+	// that have never been drawn to, so only its dirty tiles need to be
+	// colored again (unless the palette has changed since)
+	bool recolor;
+	uint8_t rgb[PPU_OUTPUT_HEIGHT][PPU_OUTPUT_WIDTH][3];
+	video_rect_t rects[VIDEO_MAX_DIRTY_RECTS];
+} raw_sink_t;
+
+static void
+raw_write_frame (raw_sink_t * nonnull raw,
+		 size_t framenum,
+		 const uint16_t (* nonnull frame)[PPU_OUTPUT_WIDTH],
+		 const video_dirty_t * nonnull dirty)
+{
+	if (raw->failed) {
+		return;
+	}
+
+	video_dirty_t everything;
+	if (raw->recolor) {
+		memset(&everything, 0xFF, sizeof(everything));
+		dirty = &everything;
+		raw->recolor = false;
+	}
+
+	// The RGBA table covers blank pixels too, so every pixel is the first
+	// 3 bytes of its entry
+	const uint32_t * rgba = raw->palette->rgba;
+	size_t nrects = video_dirty_rects(dirty, raw->rects);
+	for (size_t i = 0; i < nrects; i++) {
+		const video_rect_t * rect = &raw->rects[i];
+		for (size_t y = rect->y; y < rect->y + rect->height; y++) {
+			for (size_t x = rect->x; x < rect->x + rect->width; x++) {
+				memcpy(raw->rgb[y][x], &rgba[frame[y][x]], 3);
+			}
+		}
+	}
+
+	if (fwrite(raw->rgb, sizeof(raw->rgb), 1, raw->f) != 1) {
+		ERROR_PRINT("Error writing %s: %s", raw->path, strerror(errno));
+		raw->failed = true;
+		return;
+	}
+	raw->nframes++;
+}
+
+static void
+raw_set_palette (raw_sink_t * nonnull raw, video_palette_t * nonnull palette)
+{
+	rc_release(raw->palette);
+	raw->palette = rc_retain(palette);
+	raw->recolor = true;
+}
+
+static void
+raw_close (raw_sink_t * nonnull raw)
+{
+	INFO_PRINT("Wrote %zu frames to %s", raw->nframes, raw->path);
+}
+
+static void
+raw_deinit (raw_sink_t * nonnull raw)
+{
+	fclose(raw->f);
+	rc_release(raw->palette);
+}
+
+video_palette_t *
+video_palette_load (const char * path)
+{
+	FILE * f = try_fopen(path, "rb");
+	if (!f) {
+		goto openerror;
+	}
+
+	video_palette_t * palette = rc_alloc(sizeof(video_palette_t), NULL);
+	if (try_fread(f, path, palette->srgb, sizeof(palette->srgb))) {
+		goto readerror;
+	}
+
+	for (size_t i = 0; i < VIDEO_PALETTE_LEN; i++) {
+		const uint8_t * srgb = palette->srgb[i];
+		uint8_t rgba[4] = {srgb[0], srgb[1], srgb[2], 255};
+		memcpy(&palette->rgba[i], rgba, sizeof(rgba));
+	}
+	palette->rgba[VIDEO_PALETTE_LEN] = 0;
+
+	fclose(f);
+	return palette;
+readerror:
+	rc_release(palette);
+	fclose(f);
+openerror:
+	return NULL;
+}
+
+size_t
+video_dirty_rects (const video_dirty_t * dirty, video_rect_t * rects)
+{
+	size_t nrects = 0;
+
+	// The rectangles that reach down to the bottom of the previous row of
+	// tiles, which are the only ones a run in this row can extend
+	size_t open[VIDEO_TILE_COLS / 2], nopen = 0;
+
+	for (size_t y = 0; y < VIDEO_TILE_ROWS; y++) {
+		size_t next_open[VIDEO_TILE_COLS / 2], nnext_open = 0;
+
+		for (uint32_t row = dirty->rows[y]; row; row &= row + (row & -row)) {
+			// Find the lowest run of set bits
+			unsigned x = (unsigned)__builtin_ctz(row);
+			uint32_t run = row >> x;
+			unsigned width = ~run ? (unsigned)__builtin_ctz(~run) : VIDEO_TILE_COLS;
+
+			video_rect_t * rect = NULL;
+			for (size_t i = 0; i < nopen; i++) {
+				video_rect_t * candidate = &rects[open[i]];
+				if (candidate->x == x * VIDEO_TILE_SIZE && candidate->width == width * VIDEO_TILE_SIZE) {
+					rect = candidate;
+					rect->height += VIDEO_TILE_SIZE;
+					next_open[nnext_open++] = open[i];
+					break;
+				}
+			}
+			if (!rect) {
+				rects[nrects] = (video_rect_t){
+					.x = (uint16_t)(x * VIDEO_TILE_SIZE),
+					.y = (uint16_t)(y * VIDEO_TILE_SIZE),
+					.width = (uint16_t)(width * VIDEO_TILE_SIZE),
+					.height = VIDEO_TILE_SIZE,
+				};
+				next_open[nnext_open++] = nrects++;
+			}
+		}
+
+		memcpy(open, next_open, nnext_open * sizeof(*open));
+		nopen = nnext_open;
+	}
+
+	return nrects;
+}
+
+int
+video_sink_open (video_sink_t * sink, const video_config_t * config, video_palette_t * palette)
+{
+	memset(sink, 0, sizeof(*sink));
+
+	switch (config->backend) {
+	case VIDEO_BACKEND_SDL: {
+		presenter_t * presenter = presenter_new(config->scale, config->ntsc, palette);
+		if (!presenter) {
+			return -1;
+		}
+		sink->obj = presenter;
+		sink->write_frame = (void *)sdl_write_frame;
+		sink->set_palette = (void *)sdl_set_palette;
+		sink->quit_requested = (void *)presenter_quit_requested;
+		sink->close = (void *)sdl_close;
+		return 0;
+	}
+	case VIDEO_BACKEND_NONE:
+		return 0;
+	case VIDEO_BACKEND_RAW: {
+		ASSERT(config->raw_path);
+		FILE * f = try_fopen(config->raw_path, "wb");
+		if (!f) {
+			return -1;
+		}
+
+		raw_sink_t * raw = rc_alloc(sizeof(raw_sink_t), raw_deinit);
+		raw->f = f;
+		raw->path = config->raw_path;
+		raw->palette = rc_retain(palette);
+		sink->obj = raw;
+		sink->write_frame = (void *)raw_write_frame;
+		sink->set_palette = (void *)raw_set_palette;
+		sink->close = (void *)raw_close;
+		return 0;
+	}
+	}
+
+	UNREACHABLE();
+	return -1;
+}
+
+void
+video_sink_close (video_sink_t * sink)
+{
+	if (!sink->obj) {
+		return;
+	}
+
+	if (sink->close) {
+		sink->close((void * nonnull)sink->obj);
+	}
+	rc_release(sink->obj);
+	memset(sink, 0, sizeof(*sink));
+}
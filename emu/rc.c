@@ -1,14 +1,46 @@
 #include <rc.h>
 
+// The arena `rc_alloc()` currently allocates from on this thread, if any
+static _Thread_local arena_t * current_arena;
+
+// Gives the memory of a dead object back to wherever it came from
+static inline void
+rc_free (rc_t * rc)
+{
+	if (rc->arena) {
+		arena_release((arena_t * nonnull)rc->arena, rc);
+	}
+	else {
+		free(rc);
+	}
+}
+
 void *
 rc_alloc (size_t size, void * deinit)
 {
-	rc_t * rc = calloc(1, size + sizeof(rc_t));
+	rc_t * rc = NULL;
+	if (current_arena) {
+		rc = arena_alloc((arena_t * nonnull)current_arena, size + sizeof(rc_t));
+	}
+	if (rc) {
+		rc->arena = current_arena;
+	}
+	else {
+		rc = calloc(1, size + sizeof(rc_t));
+	}
 	rc->strong_count = 1;
 	rc->deinit = deinit;
 	return rc + 1;
 }
 
+arena_t *
+rc_use_arena (arena_t * arena)
+{
+	arena_t * prev = current_arena;
+	current_arena = arena;
+	return prev;
+}
+
 void *
 rc_retain (void * obj)
 {
@@ -34,7 +66,7 @@ rc_release (void * obj)
 			rc->deinit(obj);
 		}
 		if (!rc->weak_count) {
-			free(rc);
+			rc_free(rc);
 		}
 	}
 }
@@ -57,7 +89,7 @@ rc_weak_release (void * nonnull obj)
 	rc->weak_count--;
 
 	if (!rc->strong_count && !rc->weak_count) {
-		free(rc);
+		rc_free(rc);
 	}
 }
 
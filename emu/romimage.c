@@ -0,0 +1,101 @@
+#include <rc.h>
+#include <base.h>
+#include <romimage.h>
+
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Guards `images`, and the reference counts of everything on it
+static pthread_mutex_t images_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Every live image in the process, so that they can be shared
+static romimage_t * images;
+
+// Called with `images_lock` held, from within `romimage_release()`
+static void
+deinit (romimage_t * image)
+{
+	romimage_t ** link = &images;
+	while (*link != image) {
+		link = &(*link)->next;
+	}
+	*link = image->next;
+
+	munmap((void *)image->data, image->size);
+}
+
+romimage_t *
+romimage_open (FILE * f, const char * path)
+{
+	int fd = fileno(f);
+
+	struct stat st;
+	if (fstat(fd, &st)) {
+		ERROR_PRINT("Error reading %s: %s", path, strerror(errno));
+		return NULL;
+	}
+
+	if (!S_ISREG(st.st_mode) || !st.st_size) {
+		ERROR_PRINT("Error reading %s: not a regular, non-empty file", path);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&images_lock);
+
+	romimage_t * image = images;
+	for (; image; image = image->next) {
+		if (image->dev == st.st_dev &&
+		    image->ino == st.st_ino &&
+		    image->size == (size_t)st.st_size &&
+		    image->mtime.tv_sec == st.st_mtim.tv_sec &&
+		    image->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+			rc_retain(image);
+			goto unlock;
+		}
+	}
+
+	void * data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		ERROR_PRINT("Error mapping %s: %s", path, strerror(errno));
+		goto unlock;
+	}
+
+	// Images outlive the machine that happened to load them first
+	arena_t * arena = rc_use_arena(NULL);
+	image = rc_alloc(sizeof(romimage_t), deinit);
+	rc_use_arena(arena);
+
+	image->data  = data;
+	image->size  = (size_t)st.st_size;
+	image->dev   = st.st_dev;
+	image->ino   = st.st_ino;
+	image->mtime = st.st_mtim;
+
+	image->next = images;
+	images = image;
+
+unlock:
+	pthread_mutex_unlock(&images_lock);
+	return image;
+}
+
+romimage_t *
+romimage_retain (romimage_t * image)
+{
+	pthread_mutex_lock(&images_lock);
+	rc_retain(image);
+	pthread_mutex_unlock(&images_lock);
+	return image;
+}
+
+void
+romimage_release (romimage_t * image)
+{
+	pthread_mutex_lock(&images_lock);
+	rc_release(image);
+	pthread_mutex_unlock(&images_lock);
+}
@@ -1,12 +1,15 @@
+#include <rc.h>
 #include <shell.h>
 #include <membus.h>
 #include <timekeeper.h>
+#include <nes/capture.h>
 #include <mos6502/mos6502.h>
 
 #include <SDL2/SDL.h>
 
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdnoreturn.h>
@@ -145,6 +148,9 @@ try_next_dec (char ** line_ptr, size_t * result)
 // Checked during CPU stepping to abort early on SIGINT
 static bool sigint_received;
 
+// The PPU of the system the shell is running on, if it has one
+static ppu_t * nullable shell_ppu;
+
 // break point level 2
 static uint8_t * bptl2[256];
 
@@ -484,9 +490,185 @@ cmd_break (mos6502_t * cpu, char * args)
 	return 0;
 }
 
+static int
+cmd_framehash (mos6502_t * cpu, char * args)
+{
+	if (!shell_ppu) {
+		ERROR_PRINT("  This system has no PPU");
+		return 0;
+	}
+
+	ppu_t * ppu = (ppu_t * nonnull)shell_ppu;
+	ppu_sync(ppu);
+	INFO_PRINT("  Frame %zu (scanline %zu): %016" PRIx64, ppu->framenum, ppu->slnum, ppu_frame_hash(ppu));
+	return 0;
+}
+
+static int
+cmd_dirty (mos6502_t * cpu, char * args)
+{
+	if (!shell_ppu) {
+		ERROR_PRINT("  This system has no PPU");
+		return 0;
+	}
+
+	ppu_t * ppu = (ppu_t * nonnull)shell_ppu;
+	ppu_sync(ppu);
+
+	video_rect_t rects[VIDEO_MAX_DIRTY_RECTS];
+	size_t nrects = video_dirty_rects(&ppu->presented_dirty, rects);
+	INFO_PRINT("  %zu rectangles changed in the last frame presented", nrects);
+	for (size_t i = 0; i < nrects; i++) {
+		INFO_PRINT("  %3u,%3u %3ux%u", rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+	}
+	return 0;
+}
+
+static int
+cmd_capture (mos6502_t * cpu, char * args)
+{
+	if (!shell_ppu || !shell_ppu->capture) {
+		ERROR_PRINT("  Nothing is being recorded");
+		return 0;
+	}
+
+	capture_print_stats((capture_t * nonnull)shell_ppu->capture);
+	return 0;
+}
+
+static int
+cmd_trace (mos6502_t * cpu, char * args)
+{
+	if (!shell_ppu || !shell_ppu->trace) {
+		ERROR_PRINT("  The PPU isn't being traced");
+		return 0;
+	}
+
+	ppu_t * ppu = (ppu_t * nonnull)shell_ppu;
+	ppu_sync(ppu);
+	ppu_trace_dump((ppu_trace_t * nonnull)ppu->trace);
+	return 0;
+}
+
+static int
+cmd_oam (mos6502_t * cpu, char * args)
+{
+	if (!shell_ppu) {
+		ERROR_PRINT("  This system has no PPU");
+		return 0;
+	}
+
+	ppu_view_t view = ppu_view((ppu_t * nonnull)shell_ppu);
+	for (size_t spritenum = 0; spritenum < 64; spritenum++) {
+		ppu_sprite_t sprite = view.sprites[spritenum];
+		INFO_PRINT("  %2zu: %3u,%3u tile $%02x attr $%02x (palette %u%s%s%s)",
+			   spritenum,
+			   sprite.xpos,
+			   sprite.ypos,
+			   sprite.tile,
+			   sprite.attr,
+			   sprite.attr & PPU_SPRITEATTR_PALETTE,
+			   sprite.attr & PPU_SPRITEATTR_BEHIND_BG ? ", behind" : "",
+			   sprite.attr & PPU_SPRITEATTR_HORIZ_FLIPPED ? ", h-flipped" : "",
+			   sprite.attr & PPU_SPRITEATTR_VERTI_FLIPPED ? ", v-flipped" : "");
+	}
+	return 0;
+}
+
+// Prints `len` bytes of `mem` 32 to a line, each line starting with the
+// address of its first byte (from `addr`)
+static void
+print_vram (const uint8_t * nonnull mem, uint16_t addr, size_t len)
+{
+	for (size_t i = 0; i < len; i += 32) {
+		char line[32 * 3 + 1];
+		for (size_t j = 0; j < 32 && i + j < len; j++) {
+			snprintf(&line[j * 3], 4, " %02x", mem[i + j]);
+		}
+		INFO_PRINT("  $%04x:%s", (uint16_t)(addr + i), line);
+	}
+}
+
+static int
+cmd_nametable (mos6502_t * cpu, char * args)
+{
+	if (!shell_ppu) {
+		ERROR_PRINT("  This system has no PPU");
+		return 0;
+	}
+
+	size_t ntnum;
+	if (try_next_dec(&args, &ntnum)) {
+		return -1;
+	}
+	if (ntnum > 3) {
+		ERROR_PRINT("  There are only nametables 0-3");
+		return 0;
+	}
+
+	ppu_view_t view = ppu_view((ppu_t * nonnull)shell_ppu);
+	if (!view.nametables[ntnum]) {
+		ERROR_PRINT("  Nametable %zu isn't plain memory", ntnum);
+		return 0;
+	}
+
+	const uint8_t * nt = (const uint8_t * nonnull)view.nametables[ntnum];
+	uint16_t addr = (uint16_t)(0x2000 + ntnum * 0x400);
+	INFO_PRINT("  Tiles:");
+	print_vram(nt, addr, 0x3C0);
+	INFO_PRINT("  Attributes:");
+	print_vram(nt + 0x3C0, addr + 0x3C0, 0x40);
+	return 0;
+}
+
+static int
+cmd_palette (mos6502_t * cpu, char * args)
+{
+	if (!shell_ppu) {
+		ERROR_PRINT("  This system has no PPU");
+		return 0;
+	}
+
+	char * path = next_token(&args);
+	if (!*path) {
+		// Print palette memory instead, as the 4 background palettes
+		// and then the 4 sprite palettes, resolving the mirrors
+		ppu_view_t view = ppu_view((ppu_t * nonnull)shell_ppu);
+		for (size_t palnum = 0; palnum < 8; palnum++) {
+			uint8_t colors[4];
+			for (size_t i = 0; i < 4; i++) {
+				colors[i] = view.palette[i ? palnum * 4 + i : (palnum % 4) * 4];
+			}
+			INFO_PRINT("  $%04x: %02x %02x %02x %02x (%s %zu)",
+				   (uint16_t)(0x3F00 + palnum * 4),
+				   colors[0],
+				   colors[1],
+				   colors[2],
+				   colors[3],
+				   palnum < 4 ? "background" : "sprite",
+				   palnum % 4);
+		}
+		return 0;
+	}
+
+	video_palette_t * palette = video_palette_load(path);
+	if (!palette) {
+		return 0;
+	}
+
+	ppu_set_palette((ppu_t * nonnull)shell_ppu, (video_palette_t * nonnull)palette);
+	rc_release(palette);
+	INFO_PRINT("  Coloring frames with %s", path);
+	return 0;
+}
+
 static noreturn int
 cmd_quit (mos6502_t * cpu, char * args)
 {
+	if (shell_ppu) {
+		ppu_finish((ppu_t * nonnull)shell_ppu);
+	}
+
 	printf("  Quitting. Goodbye.\n");
 	exit(0);
 }
@@ -575,6 +757,41 @@ static const command_descriptor_t commands[] = {
 		"<hex16 addr> ",
 		"Sets a breakpoint at addr",
 		cmd_break},
+
+	{SPELLINGS("framehash", "fh"),
+		"",
+		"Prints the hash of the frame drawn so far",
+		cmd_framehash},
+
+	{SPELLINGS("dirty"),
+		"",
+		"Lists the rectangles that changed in the last frame presented",
+		cmd_dirty},
+
+	{SPELLINGS("capture", "cap"),
+		"",
+		"Prints how many frames have been recorded and dropped",
+		cmd_capture},
+
+	{SPELLINGS("trace"),
+		"",
+		"Dumps the PPU's trace of timing events so far",
+		cmd_trace},
+
+	{SPELLINGS("palette", "pal"),
+		"[path] ",
+		"Colors frames with the palette at path from now on, or prints palette memory",
+		cmd_palette},
+
+	{SPELLINGS("oam"),
+		"",
+		"Prints every sprite in OAM",
+		cmd_oam},
+
+	{SPELLINGS("nametable", "nt"),
+		"<dec n> ",
+		"Prints the tiles and attributes in nametable n (0-3)",
+		cmd_nametable},
 };
 
 static void
@@ -627,8 +844,10 @@ handle_sigint (int signum)
 static const struct sigaction sigint_action = {.sa_handler = handle_sigint};
 
 void
-run_shell (mos6502_t * cpu, bool interactive)
+run_shell (mos6502_t * cpu, ppu_t * ppu, bool interactive)
 {
+	shell_ppu = ppu;
+
 	if (sigaction(SIGINT, &sigint_action, NULL)) {
 		ERROR_PRINT("  Couldn't register a SIGINT handler");
 		return;
@@ -6,25 +6,25 @@
 void
 timekeeper_advance_clk (timekeeper_t * tk, uint64_t ncycles)
 {
-	uint64_t mincount = ncycles;
+	while (ncycles) {
+		uint64_t mincount = ncycles;
 
-	for (size_t i = 0; i < tk->ntimers; i++) {
-		if (tk->timers[i].countdown[0] < mincount) {
-			mincount = tk->timers[i].countdown[0];
+		for (size_t i = 0; i < tk->ntimers; i++) {
+			if (tk->timers[i].countdown[0] < mincount) {
+				mincount = tk->timers[i].countdown[0];
+			}
 		}
-	}
 
-	tk->clk_cyclenum += mincount;
+		tk->clk_cyclenum += mincount;
 
-	for (size_t i = 0; i < tk->ntimers; i++) {
-		tk->timers[i].countdown[0] -= mincount;
-		if (tk->timers[i].countdown[0] == 0) {
-			tk->timers[i].fire((void * nonnull)tk->timers[i].obj);
+		for (size_t i = 0; i < tk->ntimers; i++) {
+			tk->timers[i].countdown[0] -= mincount;
+			if (tk->timers[i].countdown[0] == 0) {
+				tk->timers[i].fire((void * nonnull)tk->timers[i].obj);
+			}
 		}
-	}
 
-	if (mincount != ncycles) {
-		timekeeper_advance_clk(tk, ncycles - mincount);
+		ncycles -= mincount;
 	}
 }
 
@@ -43,6 +43,10 @@ timekeeper_add_timer (timekeeper_t * tk, void * timer, void * fire, uint64_t * c
 void
 timekeeper_sync (timekeeper_t * tk)
 {
+	if (!tk->clk_period) {
+		return;
+	}
+
 	uint32_t t_target = (uint32_t)(tk->clk_period * tk->clk_cyclenum * 1e3 + tk->t_ref);
 	uint32_t t_now = SDL_GetTicks();
 	if (t_now < t_target) {
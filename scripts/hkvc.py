@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Decodes a capture recorded with `hawknest --record` (see emu/include/nes/capture.h
+# for the format) into raw frames, e.g. for
+#
+#   scripts/hkvc.py capture.hkvc | ffmpeg -f rawvideo -pixel_format rgb24 \
+#       -video_size 256x240 -framerate 60 -i - capture.mp4
+#
+# Pixels that were never drawn to come out black. With --indices, frames are
+# written as the PPU's 16-bit palette indices instead, exactly as they were in
+# its framebuffer.
+
+import argparse
+import array
+import struct
+import sys
+
+UNCHANGED = 0xFFFF
+BLANK = 0x200
+
+
+def frames(f):
+    magic, version, width, height = struct.unpack("<4sBHH", f.read(9))
+    if magic != b"HKVC" or version != 1:
+        raise ValueError("not a version 1 Hawknest capture")
+    palette = f.read(512 * 3)
+
+    npixels = width * height
+    prev = array.array("H", [BLANK]) * npixels
+    while True:
+        header = f.read(8)
+        if len(header) < 8:
+            break
+        framenum, nbytes = struct.unpack("<II", header)
+        runs = array.array("H", f.read(nbytes))
+        if sys.byteorder != "little":
+            runs.byteswap()
+
+        pixels = array.array("H")
+        for i in range(0, len(runs), 2):
+            length, val = runs[i], runs[i + 1]
+            if val == UNCHANGED:
+                pixels.extend(prev[len(pixels):len(pixels) + length])
+            else:
+                pixels.extend(array.array("H", [val]) * length)
+        if len(pixels) != npixels:
+            raise ValueError("frame %d covers %d pixels, not %d" % (framenum, len(pixels), npixels))
+
+        prev = pixels
+        yield framenum, palette, pixels
+
+
+def to_rgb(palette, pixels):
+    rgb = bytearray(len(pixels) * 3)
+    for i, px in enumerate(pixels):
+        if px != BLANK:
+            rgb[3 * i:3 * i + 3] = palette[3 * px:3 * px + 3]
+    return rgb
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a Hawknest capture into raw frames")
+    parser.add_argument("capture", help="the capture to decode")
+    parser.add_argument("output", nargs="?", help="where to write the frames (default: stdout)")
+    parser.add_argument("-i", "--indices", action="store_true",
+                        help="write 16-bit palette indices rather than RGB24")
+    options = parser.parse_args()
+
+    out = open(options.output, "wb") if options.output else sys.stdout.buffer
+    with open(options.capture, "rb") as f:
+        for framenum, palette, pixels in frames(f):
+            if options.indices:
+                if sys.byteorder != "little":
+                    pixels.byteswap()
+                out.write(pixels.tobytes())
+            else:
+                out.write(to_rgb(palette, pixels))
+
+
+if __name__ == "__main__":
+    main()
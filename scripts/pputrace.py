@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+# Converts a PPU trace dumped by `hawknest --ppu-trace` (see
+# emu/include/nes/ppu_trace.h for the format) into the Chrome trace event
+# format, to be opened in https://ui.perfetto.dev or chrome://tracing, e.g.
+#
+#   scripts/pputrace.py trace.hkpt trace.json
+#
+# Vblank shows up as a span from when its flag is set to when it's cleared,
+# and everything else as instant events, on a track for each kind. With
+# --text, the events are listed one per line instead.
+
+import argparse
+import json
+import struct
+import sys
+
+# The NTSC master clock, in cycles per microsecond
+MASTER_CLOCK_MHZ = 236.25 / 11
+
+VBLANK_SET, VBLANK_CLEAR, NMI, SPRITE0_HIT, OVERFLOW, READ, WRITE, OAMDMA, VRAM_ADDR = range(9)
+
+EVENT_NAMES = {
+    VBLANK_SET: "vblank set",
+    VBLANK_CLEAR: "vblank clear",
+    NMI: "NMI",
+    SPRITE0_HIT: "sprite 0 hit",
+    OVERFLOW: "sprite overflow",
+    READ: "read",
+    WRITE: "write",
+    OAMDMA: "OAMDMA",
+    VRAM_ADDR: "VRAM address",
+}
+
+REGISTER_NAMES = ["PPUCTRL", "PPUMASK", "PPUSTATUS", "OAMADDR",
+                  "OAMDATA", "PPUSCROLL", "PPUADDR", "PPUDATA"]
+
+# The track each kind of event goes on
+TRACKS = {
+    VBLANK_SET: 1, VBLANK_CLEAR: 1, NMI: 1,
+    SPRITE0_HIT: 2, OVERFLOW: 2,
+    READ: 3, WRITE: 3, OAMDMA: 3,
+    VRAM_ADDR: 4,
+}
+TRACK_NAMES = {1: "Vblank and NMI", 2: "Sprite flags", 3: "CPU accesses", 4: "VRAM address"}
+
+
+def records(f):
+    magic, version, record_size, divisor, nrecorded = struct.unpack("<4sBBHQ", f.read(16))
+    if magic != b"HKPT" or version != 1 or record_size != 16:
+        raise ValueError("not a version 1 Hawknest PPU trace")
+
+    def generate():
+        while True:
+            record = f.read(16)
+            if len(record) < 16:
+                break
+            yield struct.unpack("<QHHHBB", record)
+
+    return nrecorded, generate()
+
+
+def describe(event, regnum, val):
+    if event == READ or event == WRITE:
+        return "%s %s $%02X" % (EVENT_NAMES[event], REGISTER_NAMES[regnum], val)
+    if event == OAMDMA:
+        return "OAMDMA from OAMADDR $%02X" % val
+    if event == VRAM_ADDR:
+        return "VRAM address $%04X" % val
+    return EVENT_NAMES[event]
+
+
+def to_chrome(recs):
+    events = [{"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "PPU"}}]
+    for tid, name in TRACK_NAMES.items():
+        events.append({"ph": "M", "pid": 1, "tid": tid, "name": "thread_name", "args": {"name": name}})
+
+    vblank_start = None
+    for cyclenum, slnum, dotnum, val, event, regnum in recs:
+        ts = cyclenum / MASTER_CLOCK_MHZ
+        args = {"scanline": slnum, "dot": dotnum, "cycle": cyclenum}
+        if event == VBLANK_SET:
+            vblank_start = ts
+        elif event == VBLANK_CLEAR and vblank_start is not None:
+            events.append({"ph": "X", "pid": 1, "tid": TRACKS[event], "name": "vblank",
+                           "ts": vblank_start, "dur": ts - vblank_start})
+            vblank_start = None
+
+        events.append({"ph": "i", "s": "t", "pid": 1, "tid": TRACKS[event],
+                       "name": describe(event, regnum, val), "ts": ts, "args": args})
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a Hawknest PPU trace for a timeline viewer")
+    parser.add_argument("trace", help="the trace to convert")
+    parser.add_argument("output", nargs="?", help="where to write it (default: stdout)")
+    parser.add_argument("-t", "--text", action="store_true",
+                        help="list the events as text, rather than as JSON")
+    options = parser.parse_args()
+
+    out = open(options.output, "w") if options.output else sys.stdout
+    with open(options.trace, "rb") as f:
+        nrecorded, recs = records(f)
+        if options.text:
+            out.write("# %d events were recorded in all\n" % nrecorded)
+            for cyclenum, slnum, dotnum, val, event, regnum in recs:
+                out.write("%12d %3d,%3d  %s\n" % (cyclenum, slnum, dotnum, describe(event, regnum, val)))
+        else:
+            json.dump(to_chrome(recs), out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,21 @@
+.include "test_hdr.inc"
+
+; DESC: Indirect zero-page pointers wrap around within page 0x00
+
+test:
+    lda #$05
+    sta $ff      ; pointer low byte at the top of page 0x00...
+    lda #$07
+    sta $00      ; ...and its high byte wraps to the bottom
+    lda #$01
+    sta $0100    ; where a non-wrapping read would find the high byte
+    lda #$0a
+    sta $0705
+    lda #$0b
+    sta $0706
+    ldx #$fe
+    lda ($01,x)  ; $01 + $fe wraps to $ff, so this reads $0705
+    tax
+    ldy #$01
+    lda ($ff),y  ; reads $0705 + 1
+    TEST_END
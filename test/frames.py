@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+# Golden-frame regression tests: runs each test ROM headless for a fixed number
+# of frames with no buttons pressed, and compares the hash of every frame drawn
+# against the sequence stored in test/frames/. Any change to what the PPU draws
+# (or to what the CPU does to get it there) shows up as the first frame whose
+# hash differs. Each ROM is run once in each of the modes below.
+#
+# Run with --update to re-record the golden sequences, after checking that the
+# changes they capture are intended.
+
+import argparse
+import glob
+import os
+import subprocess
+import sys
+import tempfile
+
+ROM_GLOBS = ["roms/testroms/*.nes", "roms/perfect/*.nes"]
+GOLDEN_DIR = "test/frames"
+NFRAMES = 600
+TIMEOUT = 60
+
+# Each mode's name, its extra arguments, and the suffix of its golden
+# sequences. Frame-skip has sequences of its own: a line with rendering disabled
+# keeps the pixels of the last frame drawn, which with frame-skip isn't the
+# frame just before it, so its frames needn't match those drawn every frame.
+# The PPU thread must draw exactly what the PPU does on the CPU's thread.
+MODES = [
+    ("every frame", [], ""),
+    ("frame-skip 3", ["--frameskip", "3"], ".f3"),
+    ("PPU thread", ["--ppu-thread"], ""),
+    ("PPU thread, frame-skip 3", ["--ppu-thread", "--frameskip", "3"], ".f3"),
+]
+
+
+def golden_path(rom, suffix):
+    name = os.path.splitext(os.path.basename(rom))[0]
+    return os.path.join(GOLDEN_DIR, name + suffix + ".hashes")
+
+
+def read_hashes(path):
+    with open(path) as f:
+        return [line.split() for line in f if line.strip()]
+
+
+def run_rom(emu, rom, nframes, mode_args):
+    with tempfile.TemporaryDirectory() as tmpdir:
+        hashes_path = os.path.join(tmpdir, "hashes")
+        args = [emu, "--video", "none", "--frames", str(nframes),
+                "--frame-hashes", hashes_path] + mode_args + [rom]
+        subprocess.run(args, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL, timeout=TIMEOUT, check=True)
+        return read_hashes(hashes_path)
+
+
+def compare(expected, actual):
+    for (exp_frame, exp_hash), (act_frame, act_hash) in zip(expected, actual):
+        if exp_frame != act_frame:
+            return "frame %s was drawn where frame %s was expected" % (act_frame, exp_frame)
+        if exp_hash != act_hash:
+            return "frame %s hashed to %s, not %s" % (act_frame, act_hash, exp_hash)
+    if len(expected) != len(actual):
+        return "%d frames were drawn, not %d" % (len(actual), len(expected))
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare frame hashes against the golden sequences")
+    parser.add_argument("-e", "--emu", default="bin/hawknest-gcc-debug",
+                        help="the Hawknest binary to test (default: %(default)s)")
+    parser.add_argument("-u", "--update", action="store_true",
+                        help="re-record the golden sequences instead of comparing against them")
+    parser.add_argument("roms", nargs="*",
+                        help="the ROMs to test (default: %s)" % " ".join(ROM_GLOBS))
+    options = parser.parse_args()
+
+    roms = options.roms or sorted(rom for pattern in ROM_GLOBS for rom in glob.glob(pattern))
+    nruns = 0
+    nfailed = 0
+
+    for rom in roms:
+        recorded = set()
+        for mode, mode_args, suffix in MODES:
+            golden = golden_path(rom, suffix)
+            # Modes that share golden sequences are only recorded once
+            if options.update and golden in recorded:
+                continue
+            nruns += 1
+
+            try:
+                actual = run_rom(options.emu, rom, NFRAMES, mode_args)
+            except (subprocess.SubprocessError, OSError) as e:
+                print("FAILED %s, %s (%s)" % (rom, mode, e))
+                nfailed += 1
+                continue
+
+            if options.update:
+                os.makedirs(GOLDEN_DIR, exist_ok=True)
+                with open(golden, "w") as f:
+                    f.writelines("%s %s\n" % (frame, h) for frame, h in actual)
+                recorded.add(golden)
+                print("RECORDED %s, %s (%d frames)" % (rom, mode, len(actual)))
+                continue
+
+            if not os.path.exists(golden):
+                print("FAILED %s, %s (no golden sequence at %s)" % (rom, mode, golden))
+                nfailed += 1
+                continue
+
+            failure = compare(read_hashes(golden), actual)
+            if failure:
+                print("FAILED %s, %s (%s)" % (rom, mode, failure))
+                nfailed += 1
+            else:
+                print("PASSED %s, %s" % (rom, mode))
+
+    if not options.update:
+        print("Passed %d of %d" % (nruns - nfailed, nruns))
+    sys.exit(1 if nfailed else 0)
+
+
+if __name__ == "__main__":
+    main()
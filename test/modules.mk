@@ -98,4 +98,5 @@ TEST_SRC += hello.c \
 			95_max.s \
 			96_mult.s \
 			97_sqrt.s \
-			98_isalpha.s 
+			98_isalpha.s \
+			99_zpwrap.s 